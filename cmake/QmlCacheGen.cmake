@@ -0,0 +1,40 @@
+# Ahead-of-time compilation of QML files that are installed on disk.
+#
+# qmlcachegen produces a .qmlc file for every QML source, the QML engine
+# picks it up instead of compiling the source as long as it sits next to
+# the .qml file and the source time stamp matches.
+#
+#   sddm_add_qml_cache(<target> DESTINATION <dir> BASE_DIR <dir> FILES <qml files>)
+#
+# FILES are relative to BASE_DIR, the generated cache files are installed
+# into DESTINATION keeping the same relative layout.
+
+include(CMakeParseArguments)
+
+function(sddm_add_qml_cache target)
+    cmake_parse_arguments(ARG "" "DESTINATION;BASE_DIR" "FILES" ${ARGN})
+
+    if(NOT QMLCACHEGEN_EXECUTABLE)
+        return()
+    endif()
+
+    set(outputs)
+    foreach(file ${ARG_FILES})
+        set(input "${ARG_BASE_DIR}/${file}")
+        set(output "${CMAKE_CURRENT_BINARY_DIR}/qmlcache/${file}c")
+        get_filename_component(output_dir "${output}" DIRECTORY)
+        get_filename_component(install_dir "${ARG_DESTINATION}/${file}" DIRECTORY)
+
+        add_custom_command(OUTPUT "${output}"
+            COMMAND ${CMAKE_COMMAND} -E make_directory "${output_dir}"
+            COMMAND ${QMLCACHEGEN_EXECUTABLE} -o "${output}" "${input}"
+            DEPENDS "${input}"
+            COMMENT "Compiling ${file}"
+            VERBATIM)
+
+        install(FILES "${output}" DESTINATION "${install_dir}")
+        list(APPEND outputs "${output}")
+    endforeach()
+
+    add_custom_target(${target} ALL DEPENDS ${outputs})
+endfunction()
@@ -27,7 +27,7 @@ import QtQuick 2.0
 FocusScope {
     id: container
 
-    property alias source: image.source
+    property url source
     property alias fillMode: image.fillMode
     property alias status: image.status
 
@@ -36,6 +36,19 @@ FocusScope {
         id: image
         anchors.fill: parent
 
+        // local files are decoded in a thread by the greeter, scaled
+        // to the size of the screen and cached for the next start
+        source: {
+            if (container.width <= 0 || container.height <= 0)
+                return "";
+            var url = container.source.toString();
+            if (typeof __sddm_backgrounds !== "undefined" && url.indexOf("file:///") === 0)
+                return "image://sddm-background/" + url.substring(8);
+            return container.source;
+        }
+        sourceSize: Qt.size(container.width, container.height)
+        asynchronous: true
+
         clip: true
         focus: true
         smooth: true
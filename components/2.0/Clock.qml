@@ -32,9 +32,15 @@ Column {
     property alias timeFont: time.font
     property alias dateFont: date.font
 
+    // wake up right after the minute changes, and only while the
+    // screen is visible, instead of polling ten times a second
     Timer {
-        interval: 100; running: true; repeat: true;
-        onTriggered: container.dateTime = new Date()
+        interval: 60000; repeat: true; triggeredOnStart: true
+        running: typeof screenActive === "undefined" || screenActive
+        onTriggered: {
+            container.dateTime = new Date()
+            interval = 60000 - container.dateTime.getSeconds() * 1000 - container.dateTime.getMilliseconds() + 50
+        }
     }
 
     Text {
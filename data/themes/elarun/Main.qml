@@ -132,6 +132,8 @@ Rectangle {
 
                             KeyNavigation.backtab: user_entry; KeyNavigation.tab: login_button
 
+                            onActiveFocusChanged: if (activeFocus) sddm.prepareLogin(user_entry.text, sessionIndex)
+
                             Keys.onPressed: {
                                 if (event.key === Qt.Key_Return || event.key === Qt.Key_Enter) {
                                     sddm.login(user_entry.text, pw_entry.text, sessionIndex)
@@ -204,12 +206,16 @@ Rectangle {
 
                     Timer {
                         id: time
-                        interval: 100
-                        running: true
+                        interval: 60000
+                        running: typeof screenActive === "undefined" || screenActive
                         repeat: true
+                        triggeredOnStart: true
 
+                        // update right after the minute changes
                         onTriggered: {
-                            dateTime.text = Qt.formatDateTime(new Date(), "dddd, dd MMMM yyyy HH:mm AP")
+                            var now = new Date()
+                            dateTime.text = Qt.formatDateTime(now, "dddd, dd MMMM yyyy HH:mm AP")
+                            interval = 60000 - now.getSeconds() * 1000 - now.getMilliseconds() + 50
                         }
                     }
 
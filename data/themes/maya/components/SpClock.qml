@@ -25,11 +25,18 @@ Item {
   implicitHeight  : sp_clock_text.implicitHeight
 
 
+  //
+  // Update right after the minute changes, only while the screen is visible
+  //
   Timer {
-    interval    : 100
-    running     : true
-    repeat      : true;
-    onTriggered : sp_clock.value = new Date()
+    interval          : 60000
+    running           : typeof screenActive === "undefined" || screenActive
+    repeat            : true
+    triggeredOnStart  : true
+    onTriggered       : {
+      sp_clock.value = new Date()
+      interval = 60000 - sp_clock.value.getSeconds() * 1000 - sp_clock.value.getMilliseconds() + 50
+    }
   }
 
   Text {
@@ -19,11 +19,16 @@
  */
 
 #include "Auth.h"
+
 #include "Constants.h"
 #include "AuthMessages.h"
 #include "SafeDataStream.h"
+#include "LogCategories.h"
 
+#include <QtCore/QFileInfo>
+#include <QtCore/QFileSystemWatcher>
 #include <QtCore/QProcess>
+#include <QtCore/QTimer>
 #include <QtCore/QUuid>
 #include <QtNetwork/QLocalServer>
 #include <QtNetwork/QLocalSocket>
@@ -47,12 +52,27 @@ namespace SDDM {
         SocketServer();
     };
 
+    // environment every helper starts with, /etc/locale.conf is parsed
+    // once and again only when inotify reports it changed
+    class LocaleEnvironment {
+    public:
+        static const QProcessEnvironment &environment();
+    private:
+        LocaleEnvironment();
+        void load();
+
+        QFileSystemWatcher m_watcher;
+        QProcessEnvironment m_environment;
+        bool m_loaded { false };
+    };
+
     class Auth::Private : public QObject {
         Q_OBJECT
     public:
         Private(Auth *parent);
         ~Private();
         void setSocket(QLocalSocket *socket);
+        void sendStart();
     public slots:
         void dataPending();
         void childExited(int exitCode, QProcess::ExitStatus exitStatus);
@@ -67,6 +87,14 @@ namespace SDDM {
         QString cookie { };
         bool autologin { false };
         bool greeter { false };
+        bool spare { false };
+        bool startPending { false };
+        bool cancelled { false };
+        // start() called while a cancelled helper was still going away
+        bool restartPending { false };
+        // delete the Auth once the helper is gone
+        bool disposing { false };
+        QTimer *killTimer { nullptr };
         QProcessEnvironment environment { };
         qint64 id { 0 };
         static qint64 lastId;
@@ -107,13 +135,40 @@ namespace SDDM {
     }
 
 
-    Auth::Private::Private(Auth *parent)
-            : QObject(parent)
-            , request(new AuthRequest(parent))
-            , child(new QProcess(this))
-            , id(lastId++) {
-        SocketServer::instance()->helpers[id] = this;
-        QProcessEnvironment env = child->processEnvironment();
+    LocaleEnvironment::LocaleEnvironment() {
+        const QString path = QStringLiteral("/etc/locale.conf");
+
+        // watch the directory too, editors replace the file instead of writing it
+        m_watcher.addPath(QFileInfo(path).absolutePath());
+        if (QFile::exists(path))
+            m_watcher.addPath(path);
+
+        QObject::connect(&m_watcher, &QFileSystemWatcher::fileChanged, [this, path] {
+            m_loaded = false;
+            if (QFile::exists(path) && !m_watcher.files().contains(path))
+                m_watcher.addPath(path);
+        });
+        QObject::connect(&m_watcher, &QFileSystemWatcher::directoryChanged, [this, path] {
+            // something else in the directory changed
+            if (m_watcher.files().contains(path) == QFile::exists(path))
+                return;
+            m_loaded = false;
+            if (QFile::exists(path))
+                m_watcher.addPath(path);
+        });
+    }
+
+    const QProcessEnvironment &LocaleEnvironment::environment() {
+        static std::unique_ptr<LocaleEnvironment> self;
+        if (!self)
+            self.reset(new LocaleEnvironment());
+        if (!self->m_loaded)
+            self->load();
+        return self->m_environment;
+    }
+
+    void LocaleEnvironment::load() {
+        QProcessEnvironment env;
         bool langEmpty = true;
         QFile localeFile(QStringLiteral("/etc/locale.conf"));
         if (localeFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
@@ -130,8 +185,24 @@ namespace SDDM {
         }
         if (langEmpty)
             env.insert(QStringLiteral("LANG"), QStringLiteral("C"));
-        child->setProcessEnvironment(env);
+
+        m_environment = env;
+        m_loaded = true;
+    }
+
+    Auth::Private::Private(Auth *parent)
+            : QObject(parent)
+            , request(new AuthRequest(parent))
+            , child(new QProcess(this))
+            , killTimer(new QTimer(this))
+            , id(lastId++) {
+        SocketServer::instance()->helpers[id] = this;
+        child->setProcessEnvironment(LocaleEnvironment::environment());
         connect(child, QOverload<int,QProcess::ExitStatus>::of(&QProcess::finished), this, &Auth::Private::childExited);
+        // a cancelled helper that ignores SIGTERM
+        killTimer->setSingleShot(true);
+        killTimer->setInterval(1000);
+        connect(killTimer, &QTimer::timeout, child, &QProcess::kill);
         connect(child, QOverload<QProcess::ProcessError>::of(&QProcess::error), this, &Auth::Private::childError);
         connect(request, &AuthRequest::finished, this, &Auth::Private::requestFinished);
         connect(request, &AuthRequest::promptsChanged, parent, &Auth::requestChanged);
@@ -146,85 +217,157 @@ namespace SDDM {
     void Auth::Private::setSocket(QLocalSocket *socket) {
         this->socket = socket;
         connect(socket, &QLocalSocket::readyRead, this, &Auth::Private::dataPending);
+
+        // the login arrived before the spare helper said hello
+        if (startPending)
+            sendStart();
+    }
+
+    void Auth::Private::sendStart() {
+        startPending = false;
+
+        SafeDataStream str(socket);
+        str << START << user << sessionPath << autologin << greeter;
+        str.send();
     }
 
     void Auth::Private::dataPending() {
         Auth *auth = qobject_cast<Auth*>(parent());
-        Msg m = MSG_UNKNOWN;
-        SafeDataStream str(socket);
-        str.receive();
-        str >> m;
-        switch (m) {
-            case ERROR: {
-                QString message;
-                Error type = ERROR_NONE;
-                str >> message >> type;
-                Q_EMIT auth->error(message, type);
-                break;
-            }
-            case INFO: {
-                QString message;
-                Info type = INFO_NONE;
-                str >> message >> type;
-                Q_EMIT auth->info(message, type);
-                break;
-            }
-            case REQUEST: {
-                Request r;
-                str >> r;
-                request->setRequest(&r);
-                break;
-            }
-            case AUTHENTICATED: {
-                QString user;
-                str >> user;
-                if (!user.isEmpty()) {
-                    auth->setUser(user);
-                    Q_EMIT auth->authentication(user, true);
+        // the helper may queue several messages before we get to run,
+        // handle all of them instead of one per readyRead
+        while (socket && socket->bytesAvailable() > 0) {
+            Msg m = MSG_UNKNOWN;
+            SafeDataStream str(socket);
+            str.receive();
+            str >> m;
+            switch (m) {
+                case ERROR: {
+                    QString message;
+                    Error type = ERROR_NONE;
+                    str >> message >> type;
+                    Q_EMIT auth->error(message, type);
+                    break;
+                }
+                case INFO: {
+                    QString message;
+                    Info type = INFO_NONE;
+                    str >> message >> type;
+                    Q_EMIT auth->info(message, type);
+                    break;
+                }
+                case REQUEST: {
+                    Request r;
+                    str >> r;
+                    request->setRequest(&r);
+                    break;
+                }
+                case AUTHENTICATED: {
+                    QString user;
+                    str >> user;
+                    if (!user.isEmpty()) {
+                        auth->setUser(user);
+                        Q_EMIT auth->authentication(user, true);
+                        // cancelled from the slot, don't let the session start
+                        if (cancelled || child->state() == QProcess::NotRunning)
+                            break;
+                        str.reset();
+                        str << AUTHENTICATED << environment << cookie;
+                        str.send();
+                    }
+                    else {
+                        Q_EMIT auth->authentication(user, false);
+                    }
+                    break;
+                }
+                case SESSION_STATUS: {
+                    bool status;
+                    str >> status;
+                    Q_EMIT auth->sessionStarted(status);
                     str.reset();
-                    str << AUTHENTICATED << environment << cookie;
+                    str << SESSION_STATUS;
                     str.send();
+                    break;
                 }
-                else {
-                    Q_EMIT auth->authentication(user, false);
+                case ACCOUNTING: {
+                    UtmpRecord record;
+                    str >> record;
+                    if (str.status() == QDataStream::Ok)
+                        Q_EMIT auth->accounting(record);
+                    break;
+                }
+                default: {
+                    Q_EMIT auth->error(QStringLiteral("Auth: Unexpected value received: %1").arg(m), ERROR_INTERNAL);
                 }
-                break;
-            }
-            case SESSION_STATUS: {
-                bool status;
-                str >> status;
-                Q_EMIT auth->sessionStarted(status);
-                str.reset();
-                str << SESSION_STATUS;
-                str.send();
-                break;
-            }
-            default: {
-                Q_EMIT auth->error(QStringLiteral("Auth: Unexpected value received: %1").arg(m), ERROR_INTERNAL);
             }
         }
     }
 
     void Auth::Private::childExited(int exitCode, QProcess::ExitStatus exitStatus) {
+        if (cancelled) {
+            cancelled = false;
+            spare = false;
+            killTimer->stop();
+            qCDebug(lcAuth) << "Auth: sddm-helper cancelled";
+
+            if (disposing) {
+                parent()->deleteLater();
+                return;
+            }
+
+            // the next login was waiting for this helper to go away
+            if (restartPending) {
+                restartPending = false;
+                qobject_cast<Auth*>(parent())->start();
+            }
+            return;
+        }
+
+        // nobody is waiting on a helper that was never handed a login
+        if (spare) {
+            spare = false;
+            qCWarning(lcAuth, "Auth: spare sddm-helper exited with %d", exitCode);
+            return;
+        }
+
         if (exitStatus != QProcess::NormalExit) {
-            qWarning("Auth: sddm-helper crashed (exit code %d)", exitCode);
+            qCWarning(lcAuth, "Auth: sddm-helper crashed (exit code %d)", exitCode);
             Q_EMIT qobject_cast<Auth*>(parent())->error(child->errorString(), ERROR_INTERNAL);
         }
 
+        // the helper exits right after its last messages (accounting
+        // records among them), handle them before the Auth may go away
+        if (socket) {
+            socket->waitForReadyRead(0);
+            dataPending();
+        }
+
         if (exitCode == HELPER_SUCCESS)
-            qDebug() << "Auth: sddm-helper exited successfully";
+            qCDebug(lcAuth) << "Auth: sddm-helper exited successfully";
         else
-            qWarning("Auth: sddm-helper exited with %d", exitCode);
+            qCWarning(lcAuth, "Auth: sddm-helper exited with %d", exitCode);
 
         Q_EMIT qobject_cast<Auth*>(parent())->finished((Auth::HelperExitStatus)exitCode);
     }
 
     void Auth::Private::childError(QProcess::ProcessError error) {
-        Q_UNUSED(error);
+        if (cancelled) {
+            // never started, so childExited() won't come
+            if (disposing && error == QProcess::FailedToStart)
+                parent()->deleteLater();
+            return;
+        }
+        if (spare) {
+            qCWarning(lcAuth) << "Auth: spare sddm-helper failed:" << child->errorString();
+            return;
+        }
         Q_EMIT qobject_cast<Auth*>(parent())->error(child->errorString(), ERROR_INTERNAL);
     }
 
     void Auth::Private::requestFinished() {
+        // the helper was cancelled meanwhile
+        if (!socket)
+            return;
+
         SafeDataStream str(socket);
         Request r = request->request();
         str << REQUEST << r;
@@ -287,7 +430,7 @@ namespace SDDM {
     }
 
     bool Auth::isActive() const {
-        return d->child->state() != QProcess::NotRunning;
+        return d->child->state() != QProcess::NotRunning && !d->spare && !d->cancelled;
     }
 
     void Auth::insertEnvironment(const QProcessEnvironment &env) {
@@ -344,7 +487,77 @@ namespace SDDM {
         }
     }
 
+    void Auth::prepare() {
+        if (d->child->state() != QProcess::NotRunning)
+            return;
+
+        // the helper connects back and waits for start() before touching PAM
+        QStringList args;
+        args << QStringLiteral("--socket") << SocketServer::instance()->fullServerName();
+        args << QStringLiteral("--id") << QStringLiteral("%1").arg(d->id);
+        args << QStringLiteral("--spare");
+        d->spare = true;
+        d->child->start(QStringLiteral("%1/sddm-helper").arg(QStringLiteral(LIBEXEC_INSTALL_DIR)), args);
+    }
+
+    void Auth::cancel() {
+        if (d->child->state() == QProcess::NotRunning)
+            return;
+
+        // already on its way out
+        if (d->cancelled)
+            return;
+
+        // the helper may be stuck in a PAM conversation, don't wait for it,
+        // childExited() drops it once it's gone
+        d->cancelled = true;
+        d->spare = false;
+        d->startPending = false;
+        d->restartPending = false;
+
+        // nothing it still sends is of interest
+        if (d->socket) {
+            d->socket->disconnect(d);
+            d->socket->abort();
+            d->socket->deleteLater();
+            d->socket = nullptr;
+        }
+
+        d->child->terminate();
+        d->killTimer->start();
+    }
+
+    void Auth::dispose() {
+        // whoever owns us may go away before the helper does
+        setParent(nullptr);
+
+        if (d->child->state() == QProcess::NotRunning) {
+            deleteLater();
+            return;
+        }
+
+        d->disposing = true;
+        cancel();
+    }
+
     void Auth::start() {
+        // a cancelled helper is still exiting, start once it's gone
+        if (d->cancelled) {
+            d->restartPending = true;
+            return;
+        }
+
+        // hand the request to the helper spawned by prepare()
+        if (d->spare && d->child->state() != QProcess::NotRunning) {
+            d->spare = false;
+            if (d->socket)
+                d->sendStart();
+            else
+                d->startPending = true;
+            return;
+        }
+        d->spare = false;
+
         QStringList args;
         args << QStringLiteral("--socket") << SocketServer::instance()->fullServerName();
         args << QStringLiteral("--id") << QStringLiteral("%1").arg(d->id);
@@ -23,6 +23,7 @@
 
 #include "AuthRequest.h"
 #include "AuthPrompt.h"
+#include "UtmpRecord.h"
 
 #include <QtCore/QObject>
 #include <QtCore/QProcessEnvironment>
@@ -152,11 +153,29 @@ namespace SDDM {
         void setCookie(const QString &cookie);
 
     public Q_SLOTS:
+        /**
+        * Spawns the helper ahead of time, it connects back and idles until
+        * start() hands it the user and session
+        */
+        void prepare();
+
         /**
         * Sets up the environment and starts the authentication
         */
         void start();
 
+        /**
+        * Stops the helper without reporting the outcome, used to drop a
+        * conversation nobody is going to answer anymore
+        */
+        void cancel();
+
+        /**
+        * Cancels the helper and deletes this object once the helper has
+        * exited, so it still gets to clean up after itself
+        */
+        void dispose();
+
     Q_SIGNALS:
         void autologinChanged();
         void greeterChanged();
@@ -206,6 +225,14 @@ namespace SDDM {
         */
         void info(QString message, Auth::Info type);
 
+        /**
+        * The helper recorded a login, logout or failed login that should go to
+        * the utmp, wtmp and btmp databases
+        *
+        * @param record the accounting record
+        */
+        void accounting(const SDDM::UtmpRecord &record);
+
     private:
         class Private;
         class SocketServer;
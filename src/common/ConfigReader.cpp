@@ -63,6 +63,82 @@ QTextStream &operator<<(QTextStream &str, const bool &val) {
 }
 
 namespace SDDM {
+    bool readIniFile(const QString &path, const IniCallback &callback) {
+        QString currentSection = QStringLiteral(IMPLICIT_SECTION);
+
+        QFile in(path);
+
+        if (!in.open(QIODevice::ReadOnly))
+            return false;
+        while (!in.atEnd()) {
+            const QString line = QString::fromUtf8(in.readLine());
+            const QStringRef lineRef = QStringRef(&line).trimmed();
+
+            // skip empty lines and comments
+            if (lineRef.isEmpty() || lineRef.startsWith(QLatin1Char('#')) || lineRef.startsWith(QLatin1Char(';')))
+                continue;
+
+            // section start
+            if (lineRef.startsWith(QLatin1Char('['))) {
+                int end = lineRef.indexOf(QLatin1Char(']'));
+                if (end > 0)
+                    currentSection = lineRef.mid(1, end - 1).trimmed().toString();
+                continue;
+            }
+
+            // value assignment
+            int separatorPosition = lineRef.indexOf(QLatin1Char('='));
+            if (separatorPosition >= 0) {
+                callback(currentSection,
+                         lineRef.left(separatorPosition).trimmed().toString(),
+                         lineRef.mid(separatorPosition + 1).trimmed().toString());
+            }
+        }
+
+        return true;
+    }
+
+    QVariant parseIniValue(const QString &value) {
+        QStringList list;
+        QString current;
+        bool quoted = false, wasQuoted = false;
+
+        for (int i = 0; i < value.size(); ++i) {
+            const QChar c = value.at(i);
+
+            if (c == QLatin1Char('"')) {
+                quoted = !quoted;
+                wasQuoted = true;
+            } else if (c == QLatin1Char('\\') && i + 1 < value.size()) {
+                const QChar next = value.at(++i);
+                if (next == QLatin1Char('n'))
+                    current += QLatin1Char('\n');
+                else if (next == QLatin1Char('t'))
+                    current += QLatin1Char('\t');
+                else if (next == QLatin1Char('r'))
+                    current += QLatin1Char('\r');
+                else
+                    current += next;
+            } else if (!quoted && c == QLatin1Char(';')) {
+                // the rest is a comment
+                break;
+            } else if (!quoted && c == QLatin1Char(',')) {
+                list << (wasQuoted ? current : current.trimmed());
+                current.clear();
+                wasQuoted = false;
+            } else {
+                current += c;
+            }
+        }
+
+        current = wasQuoted ? current : current.trimmed();
+        if (list.isEmpty())
+            return current;
+
+        list << current;
+        return list;
+    }
+
     // has to be specialised because QTextStream reads only words into a QString
     template <> void ConfigEntry<QString>::setValue(const QString &str) {
         m_value = str.trimmed();
@@ -189,41 +265,24 @@ namespace SDDM {
 
 
     void ConfigBase::loadInternal(const QString &filepath) {
-        QString currentSection = QStringLiteral(IMPLICIT_SECTION);
-
-        QFile in(filepath);
-
-        if (!in.open(QIODevice::ReadOnly))
-            return;
-        while (!in.atEnd()) {
-            QString line = QString::fromUtf8(in.readLine());
-            QStringRef lineRef = QStringRef(&line).trimmed();
-            // get rid of comments first
-            lineRef = lineRef.left(lineRef.indexOf(QLatin1Char('#'))).trimmed();
-
+        readIniFile(filepath, [this](QString section, const QString &name, const QString &rawValue) {
             // In version 0.14.0, these sections were renamed
-            if (currentSection == QStringLiteral("XDisplay"))
-                currentSection = QStringLiteral("X11");
-            else if (currentSection == QStringLiteral("WaylandDisplay"))
-                currentSection = QStringLiteral("Wayland");
-
-            // value assignment
-            int separatorPosition = lineRef.indexOf(QLatin1Char('='));
-            if (separatorPosition >= 0) {
-                QString name = lineRef.left(separatorPosition).trimmed().toString();
-                QStringRef value = lineRef.mid(separatorPosition + 1).trimmed();
+            if (section == QStringLiteral("XDisplay"))
+                section = QStringLiteral("X11");
+            else if (section == QStringLiteral("WaylandDisplay"))
+                section = QStringLiteral("Wayland");
 
-                auto sectionIterator = m_sections.constFind(currentSection);
-                if (sectionIterator != m_sections.constEnd() && sectionIterator.value()->entry(name))
-                    sectionIterator.value()->entry(name)->setValue(value.toString());
-                else
-                    // if we don't have such member in the config, nag about it
-                    m_unusedVariables = true;
-            }
-            // section start
-            else if (lineRef.startsWith(QLatin1Char('[')) && lineRef.endsWith(QLatin1Char(']')))
-                currentSection = lineRef.mid(1, lineRef.length() - 2).toString();
-        }
+            // get rid of comments first
+            QStringRef value = QStringRef(&rawValue);
+            value = value.left(value.indexOf(QLatin1Char('#'))).trimmed();
+
+            auto sectionIterator = m_sections.constFind(section);
+            if (sectionIterator != m_sections.constEnd() && sectionIterator.value()->entry(name))
+                sectionIterator.value()->entry(name)->setValue(value.toString());
+            else
+                // if we don't have such member in the config, nag about it
+                m_unusedVariables = true;
+        });
     }
 
     void ConfigBase::save(const ConfigSection *section, const ConfigEntryBase *entry) {
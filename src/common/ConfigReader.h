@@ -27,6 +27,9 @@
 #include <QtCore/QDebug>
 #include <QtCore/QDateTime>
 #include <QtCore/QDir>
+#include <QtCore/QVariant>
+
+#include <functional>
 
 #define IMPLICIT_SECTION "General"
 #define UNUSED_VARIABLE_COMMENT "# Unused variable"
@@ -67,6 +70,14 @@ QTextStream &operator>>(QTextStream &str, bool &val);
 QTextStream &operator<<(QTextStream &str, const bool &val);
 
 namespace SDDM {
+    typedef std::function<void(const QString &section, const QString &key, const QString &value)> IniCallback;
+
+    // Reads an INI file without going through QSettings, calling back for
+    // every assignment with the section it's in and the raw value
+    bool readIniFile(const QString &path, const IniCallback &callback);
+    // Unescapes a raw value like QSettings does, a comma makes it a list
+    QVariant parseIniValue(const QString &value);
+
     template<class> class ConfigEntry;
     class ConfigSection;
     class ConfigBase;
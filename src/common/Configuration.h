@@ -44,6 +44,12 @@ namespace SDDM {
                                                                                                    "NOTE: Currently ignored if autologin is enabled."));
         Entry(InputMethod,         QString,     QStringLiteral("qtvirtualkeyboard"),                   _S("Input method module"));
         Entry(Namespaces,          QStringList, QStringList(),                                  _S("Comma-separated list of Linux namespaces for user session to enter"));
+        Entry(PrepareHelper,       bool,        true,                                           _S("Keep an authentication helper started ahead of time on every seat,\n"
+                                                                                                   "so logging in doesn't wait for it to start"));
+        Entry(MetricsFile,         QString,     QString(),                                      _S("File the daemon periodically writes its metrics to, in the Prometheus\n"
+                                                                                                   "text format. Empty to only export them on D-Bus"));
+        Entry(MetricsInterval,     int,         60,                                             _S("Seconds between writes of the metrics file"));
+        Entry(LogRules,            QStringList, QStringList(),                                  _S("Comma-separated list of logging rules, e.g. sddm.*.debug=false,sddm.auth.debug=true"));
         //  Name   Entries (but it's a regular class again)
         Section(Theme,
             Entry(ThemeDir,            QString,     _S(DATA_INSTALL_DIR "/themes"),             _S("Theme directory path"));
@@ -51,7 +57,10 @@ namespace SDDM {
             Entry(FacesDir,            QString,     _S(DATA_INSTALL_DIR "/faces"),              _S("Global directory for user avatars\n"
                                                                                                    "The files should be named <username>.face.icon"));
             Entry(CursorTheme,         QString,     QString(),                                  _S("Cursor theme used in the greeter"));
+            Entry(CacheDir,            QString,     _S(QML_CACHE_DIR),                          _S("Directory where the greeter caches compiled theme files"));
             Entry(Font,                QString,     QString(),                                  _S("Font used in the greeter"));
+            Entry(IdleTimeout,         int,         30,                                         _S("Seconds without input after which the greeter stops\n"
+                                                                                                   "blinking the text cursor, 0 keeps it blinking"));
             Entry(EnableAvatars,       bool,        true,                                       _S("Enable display of custom user avatars"));
             Entry(DisableAvatarsThreshold,int,      7,                                          _S("Number of users to use as threshold\n"
                                                                                                    "above which avatars are disabled\n"
@@ -74,6 +83,8 @@ namespace SDDM {
             Entry(EnableHiDPI,         bool,        false,                                      _S("Enable Qt's automatic high-DPI scaling"));
             Entry(EnableNesting,       bool,        false,                                      _S("Enable use of nested driver for seats"));
             Entry(SeatConfDir,         QString,     _S("/etc/X11"),                             _S("Directory for screen configurations of nested seats"));
+            Entry(PrepareGreeter,      bool,        true,                                       _S("Start the greeter while the display server is still starting.\n"
+                                                                                                   "Only used when the display is known in advance, as for nested seats"));
         );
 
         Section(Wayland,
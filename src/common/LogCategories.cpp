@@ -0,0 +1,51 @@
+/***************************************************************************
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+
+#include "LogCategories.h"
+
+namespace SDDM {
+    Q_LOGGING_CATEGORY(lcSeat, "sddm.seat")
+    Q_LOGGING_CATEGORY(lcDisplay, "sddm.display")
+    Q_LOGGING_CATEGORY(lcXorg, "sddm.xorg")
+    Q_LOGGING_CATEGORY(lcAuth, "sddm.auth")
+    Q_LOGGING_CATEGORY(lcSocket, "sddm.socket")
+    Q_LOGGING_CATEGORY(lcConfig, "sddm.config")
+    Q_LOGGING_CATEGORY(lcGreeterModels, "sddm.greeter.models")
+
+    static QStringList logRules;
+    static bool debugForced = false;
+
+    static void applyLogRules() {
+        QStringList rules = logRules;
+        // later rules win
+        if (debugForced)
+            rules << QStringLiteral("sddm.*.debug=true");
+        QLoggingCategory::setFilterRules(rules.join(QLatin1Char('\n')));
+    }
+
+    void setLogRules(const QStringList &rules) {
+        logRules = rules;
+        applyLogRules();
+    }
+
+    void toggleDebugLogging() {
+        debugForced = !debugForced;
+        applyLogRules();
+    }
+}
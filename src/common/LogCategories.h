@@ -0,0 +1,48 @@
+/***************************************************************************
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+
+#ifndef SDDM_LOGCATEGORIES_H
+#define SDDM_LOGCATEGORIES_H
+
+#include <QLoggingCategory>
+#include <QStringList>
+
+namespace SDDM {
+    Q_DECLARE_LOGGING_CATEGORY(lcSeat)
+    Q_DECLARE_LOGGING_CATEGORY(lcDisplay)
+    Q_DECLARE_LOGGING_CATEGORY(lcXorg)
+    Q_DECLARE_LOGGING_CATEGORY(lcAuth)
+    Q_DECLARE_LOGGING_CATEGORY(lcSocket)
+    Q_DECLARE_LOGGING_CATEGORY(lcConfig)
+    Q_DECLARE_LOGGING_CATEGORY(lcGreeterModels)
+
+    /**
+     * Sets the logging rules, as in QLoggingCategory::setFilterRules, one
+     * rule per list entry, e.g. "sddm.auth.debug=true".
+     */
+    void setLogRules(const QStringList &rules);
+
+    /**
+     * Switches debug output of every sddm category on, or back to the
+     * rules set with \ref setLogRules.
+     */
+    void toggleDebugLogging();
+}
+
+#endif // SDDM_LOGCATEGORIES_H
@@ -23,21 +23,36 @@
 
 #include "Constants.h"
 
+#include <QAtomicInteger>
 #include <QDateTime>
-#include <QFile>
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
 
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
+#include <unistd.h>
 
 #ifdef HAVE_JOURNALD
 #include <systemd/sd-journal.h>
-#include <unistd.h>
 #endif
 
 namespace SDDM {
+    struct LogEntry {
+        QtMsgType type { QtDebugMsg };
+        qint64 time { 0 };
+        int line { 0 };
+        QByteArray prefix;
+        QByteArray message;
+        QByteArray file;
+        QByteArray function;
+    };
+
 #ifdef HAVE_JOURNALD
-    static void journaldLogger(QtMsgType type, const QMessageLogContext &context, const QString &msg) {
+    static void journaldLogger(const LogEntry &entry) {
         int priority = LOG_INFO;
-        switch (type) {
+        switch (entry.type) {
             case QtDebugMsg:
                 priority = LOG_DEBUG;
             break;
@@ -55,83 +70,259 @@ namespace SDDM {
         }
 
         char fileBuffer[PATH_MAX + sizeof("CODE_FILE=")];
-        snprintf(fileBuffer, sizeof(fileBuffer), "CODE_FILE=%s", context.file ? context.file : "unknown");
+        snprintf(fileBuffer, sizeof(fileBuffer), "CODE_FILE=%s", entry.file.isEmpty() ? "unknown" : entry.file.constData());
 
         char lineBuffer[32];
-        snprintf(lineBuffer, sizeof(lineBuffer), "CODE_LINE=%d", context.line);
+        snprintf(lineBuffer, sizeof(lineBuffer), "CODE_LINE=%d", entry.line);
 
         sd_journal_print_with_location(priority, fileBuffer, lineBuffer,
-                                       context.function ? context.function : "unknown",
-                                       "%s", qPrintable(msg));
+                                       entry.function.isEmpty() ? "unknown" : entry.function.constData(),
+                                       "%s", entry.message.constData());
     }
 #endif
 
-    static void standardLogger(QtMsgType type, const QString &msg) {
-        static QFile file(QStringLiteral(LOG_FILE));
-
-        // try to open file only if it's not already open
-        if (!file.isOpen()) {
-            if (!file.open(QFile::Append | QFile::WriteOnly))
-                file.open(QFile::Truncate | QFile::WriteOnly);
-        }
-
+    static QByteArray standardFormat(const LogEntry &entry) {
         // create timestamp
-        QString timestamp = QDateTime::currentDateTime().toString(QStringLiteral("hh:mm:ss.zzz"));
+        QString timestamp = QDateTime::fromMSecsSinceEpoch(entry.time).toString(QStringLiteral("hh:mm:ss.zzz"));
 
         // set log priority
-	QString logPriority = QStringLiteral("(II)");
-        switch (type) {
+        QByteArray logPriority("(II)");
+        switch (entry.type) {
             case QtDebugMsg:
             break;
             case QtWarningMsg:
-                logPriority = QStringLiteral("(WW)");
+                logPriority = "(WW)";
             break;
             case QtCriticalMsg:
             case QtFatalMsg:
-                logPriority = QStringLiteral("(EE)");
+                logPriority = "(EE)";
+            break;
+            default:
             break;
-	    default:
-	    break;
         }
 
         // prepare log message
-        QString logMessage = QStringLiteral("[%1] %2 %3\n").arg(timestamp).arg(logPriority).arg(msg);
-
-        // log message
-        if (file.isOpen()) {
-            file.write(logMessage.toLocal8Bit());
-            file.flush();
-        } else {
-            printf("%s", qPrintable(logMessage));
-            fflush(stdout);
-        }
+        return "[" + timestamp.toLocal8Bit() + "] " + logPriority + " " + entry.prefix + entry.message + "\n";
     }
 
-    static void messageHandler(QtMsgType type, const QMessageLogContext &context, const QString &prefix, const QString &msg) {
-        // copy message to edit it
-        QString logMessage = msg;
+    /**
+     * Moves log output off the calling thread.
+     *
+     * Messages are pushed into a fixed size lock-free ring and a
+     * background thread writes them out in batches. When the ring is full
+     * messages are counted and dropped instead of blocking the caller.
+     * Critical and fatal messages are written synchronously, together
+     * with everything queued before them.
+     */
+    class LogWriter : public QThread {
+    public:
+        static LogWriter &instance() {
+            static LogWriter writer;
+            return writer;
+        }
 
-#ifdef HAVE_JOURNALD
-        // don't log to journald if running interactively, this is likely
-        // the case when running sddm in test mode
-        static bool isInteractive = isatty(STDIN_FILENO);
-        if (!isInteractive) {
-            // log to journald
-            journaldLogger(type, context, logMessage);
-        } else {
-            // prepend program name
-            logMessage = prefix + msg;
-
-            // log to file or stdout
-            standardLogger(type, logMessage);
+        void log(LogEntry &&entry) {
+            // a forked child (e.g. the session before exec) has no writer thread
+            if (getpid() != m_pid) {
+                write(entry);
+                return;
+            }
+
+            if (entry.type == QtCriticalMsg || entry.type == QtFatalMsg) {
+                QMutexLocker locker(&m_outputMutex);
+                drain();
+                write(entry);
+                return;
+            }
+
+            if (!push(entry)) {
+                m_dropped.fetchAndAddRelaxed(1);
+                return;
+            }
+
+            // only wake the writer up once per batch
+            if (m_signalled.testAndSetOrdered(0, 1)) {
+                QMutexLocker locker(&m_wakeMutex);
+                m_wakeup.wakeOne();
+            }
+        }
+
+    protected:
+        void run() override {
+            forever {
+                {
+                    QMutexLocker locker(&m_wakeMutex);
+                    while (!m_stopping && !m_signalled.load())
+                        m_wakeup.wait(&m_wakeMutex);
+
+                    // give the batch a moment to fill up
+                    if (!m_stopping)
+                        m_wakeup.wait(&m_wakeMutex, FlushInterval);
+                }
+
+                m_signalled.store(0);
+
+                QMutexLocker locker(&m_outputMutex);
+                drain();
+                if (m_stopping)
+                    return;
+            }
         }
-#else
-        // prepend program name
-        logMessage = prefix + msg;
 
-        // log to file or stdout
-        standardLogger(type, logMessage);
+    private:
+        // power of two, the ring index is masked
+        static const quint32 RingSize = 1024;
+        // how long the writer waits for more messages before writing
+        static const unsigned long FlushInterval = 50;
+
+        struct Cell {
+            QAtomicInteger<quint32> sequence;
+            LogEntry entry;
+        };
+
+        LogWriter() : m_pid(getpid()) {
+            for (quint32 i = 0; i < RingSize; ++i)
+                m_ring[i].sequence.store(i);
+
+            // try to open the log file, fall back to stdout
+            m_fd = ::open(LOG_FILE, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+            if (m_fd < 0)
+                m_fd = ::open(LOG_FILE, O_WRONLY | O_TRUNC | O_CLOEXEC);
+
+            start(QThread::LowPriority);
+        }
+
+        ~LogWriter() {
+            // the thread only exists in the process that started it
+            if (getpid() != m_pid)
+                return;
+
+            {
+                QMutexLocker locker(&m_wakeMutex);
+                m_stopping = true;
+                m_wakeup.wakeOne();
+            }
+            wait();
+
+            if (m_fd >= 0)
+                ::close(m_fd);
+        }
+
+        // bounded multi-producer queue, the slot sequence numbers tell
+        // producers and the consumer whose turn it is
+        bool push(LogEntry &entry) {
+            quint32 pos = m_head.load();
+            Cell *cell;
+            forever {
+                cell = &m_ring[pos & (RingSize - 1)];
+                qint32 diff = qint32(cell->sequence.loadAcquire() - pos);
+                if (diff == 0) {
+                    if (m_head.testAndSetRelaxed(pos, pos + 1))
+                        break;
+                    pos = m_head.load();
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    pos = m_head.load();
+                }
+            }
+            cell->entry = std::move(entry);
+            cell->sequence.storeRelease(pos + 1);
+            return true;
+        }
+
+        // only called with m_outputMutex held, so there is one consumer
+        bool pop(LogEntry &entry) {
+            quint32 pos = m_tail;
+            Cell *cell = &m_ring[pos & (RingSize - 1)];
+            if (qint32(cell->sequence.loadAcquire() - (pos + 1)) < 0)
+                return false;
+            entry = std::move(cell->entry);
+            cell->entry = LogEntry();
+            cell->sequence.storeRelease(pos + RingSize);
+            m_tail = pos + 1;
+            return true;
+        }
+
+        void drain() {
+            QByteArray batch;
+
+            int dropped = m_dropped.fetchAndStoreRelaxed(0);
+            if (dropped > 0) {
+                LogEntry entry;
+                entry.type = QtWarningMsg;
+                entry.time = QDateTime::currentMSecsSinceEpoch();
+                entry.message = QByteArray::number(dropped) + " log messages dropped";
+                append(batch, entry);
+            }
+
+            LogEntry entry;
+            while (pop(entry))
+                append(batch, entry);
+
+            writeOut(batch);
+        }
+
+        void write(const LogEntry &entry) {
+            QByteArray batch;
+            append(batch, entry);
+            writeOut(batch);
+        }
+
+        void append(QByteArray &batch, const LogEntry &entry) {
+#ifdef HAVE_JOURNALD
+            // don't log to journald if running interactively, this is likely
+            // the case when running sddm in test mode
+            static bool isInteractive = isatty(STDIN_FILENO);
+            if (!isInteractive) {
+                journaldLogger(entry);
+                return;
+            }
 #endif
+            batch.append(standardFormat(entry));
+        }
+
+        void writeOut(const QByteArray &batch) {
+            int fd = m_fd >= 0 ? m_fd : STDOUT_FILENO;
+            const char *data = batch.constData();
+            qint64 length = batch.size();
+            while (length > 0) {
+                ssize_t written = ::write(fd, data, length);
+                if (written < 0) {
+                    if (errno == EINTR)
+                        continue;
+                    return;
+                }
+                data += written;
+                length -= written;
+            }
+        }
+
+        Cell m_ring[RingSize];
+        QAtomicInteger<quint32> m_head { 0 };
+        quint32 m_tail { 0 };
+        QAtomicInt m_dropped { 0 };
+        QAtomicInt m_signalled { 0 };
+        bool m_stopping { false };
+        QMutex m_wakeMutex;
+        QMutex m_outputMutex;
+        QWaitCondition m_wakeup;
+        pid_t m_pid { 0 };
+        int m_fd { -1 };
+    };
+
+    static void messageHandler(QtMsgType type, const QMessageLogContext &context, const QString &prefix, const QString &msg) {
+        LogEntry entry;
+        entry.type = type;
+        entry.time = QDateTime::currentMSecsSinceEpoch();
+        entry.line = context.line;
+        entry.prefix = prefix.toLocal8Bit();
+        entry.message = msg.toLocal8Bit();
+        // the context may point to temporary buffers, e.g. for QML messages
+        entry.file = context.file;
+        entry.function = context.function;
+
+        LogWriter::instance().log(std::move(entry));
     }
 
     void DaemonMessageHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg) {
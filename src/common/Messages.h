@@ -20,9 +20,29 @@
 #ifndef SDDM_MESSAGES_H
 #define SDDM_MESSAGES_H
 
+#include <QDataStream>
 #include <QFlags>
 
 namespace SDDM {
+    /**
+     * Version of the greeter protocol.
+     *
+     * 1: length-prefixed frames, the daemon answers Connect with Version
+     *    and Capabilities
+     * 2: the daemon answers Connect with Welcome instead
+     *
+     * The greeter sends the version it speaks in Connect and the daemon
+     * replies in the encoding of the highest version both sides know.
+     * Bump it whenever a message gains fields, and append new message
+     * types at the end of the enums below. New messages use a fixed layout
+     * of fixed-width integers. Every message travels in its own
+     * length-prefixed frame, so a peer skips types it doesn't know.
+     */
+    const quint32 ProtocolVersion = 2;
+
+    // QDataStream format of all message payloads
+    const int ProtocolStreamVersion = QDataStream::Qt_5_8;
+
     enum class GreeterMessages {
         Connect = 0,
         Login,
@@ -30,16 +50,28 @@ namespace SDDM {
         Reboot,
         Suspend,
         Hibernate,
-        HybridSleep
+        HybridSleep,
+        WaitForDisplay,
+        StartupTimings,
+        PrepareLogin
     };
 
     enum class DaemonMessages {
         HostName,
         Capabilities,
         LoginSucceeded,
-        LoginFailed
+        LoginFailed,
+        DisplayReady,
+        Version,
+        Welcome
     };
 
+    /**
+     * Payload of DaemonMessages::Welcome: the negotiated version followed
+     * by the capabilities, both quint32.
+     */
+    const int WelcomeSize = 2 * sizeof(quint32);
+
     enum Capability {
         None = 0x0000,
         PowerOff = 0x0001,
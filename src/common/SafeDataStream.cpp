@@ -20,6 +20,8 @@
 
 #include "SafeDataStream.h"
 
+#include "LogCategories.h"
+
 #include <QtCore/QDebug>
 
 namespace SDDM {
@@ -31,14 +33,14 @@ namespace SDDM {
         qint64 length = m_data.length();
         qint64 writtenTotal = 0;
         if (!m_device->isOpen()) {
-            qCritical() << " Auth: SafeDataStream: Could not write any data";
+            qCCritical(lcSocket) << " Auth: SafeDataStream: Could not write any data";
             return;
         }
         m_device->write((const char*) &length, sizeof(length));
         while (writtenTotal != length) {
             qint64 written = m_device->write(m_data.mid(writtenTotal));
             if (written < 0 || !m_device->isOpen()) {
-                qCritical() << " Auth: SafeDataStream: Could not write all stored data";
+                qCCritical(lcSocket) << " Auth: SafeDataStream: Could not write all stored data";
                 return;
             }
             writtenTotal += written;
@@ -52,7 +54,7 @@ namespace SDDM {
         qint64 length = -1;
 
         if (!m_device->isOpen()) {
-            qCritical() << " Auth: SafeDataStream: Could not read from the device";
+            qCCritical(lcSocket) << " Auth: SafeDataStream: Could not read from the device";
             return;
         }
         if (!m_device->bytesAvailable())
@@ -65,7 +67,7 @@ namespace SDDM {
 
         while (m_data.length() < length) {
             if (!m_device->isOpen()) {
-                qCritical() << " Auth: SafeDataStream: Could not read from the device";
+                qCCritical(lcSocket) << " Auth: SafeDataStream: Could not read from the device";
                 return;
             }
             if (!m_device->bytesAvailable())
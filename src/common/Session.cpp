@@ -18,16 +18,97 @@
 * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 ***************************************************************************/
 
+#include <QDateTime>
+#include <QDebug>
 #include <QFile>
 #include <QFileInfo>
+#include <QHash>
 #include <QTextStream>
 
 #include "Configuration.h"
+
 #include "Session.h"
+#include "LogCategories.h"
 
 const QString s_entryExtention = QStringLiteral(".desktop");
 
 namespace SDDM {
+    // Parsed "Desktop Entry" section of a session file, shared by every
+    // Session pointing to the same path until the file changes on disk
+    struct DesktopEntry {
+        QDateTime lastModified;
+        qint64 size { -1 };
+        QString name;
+        QString comment;
+        QString exec;
+        QString tryExec;
+        QString desktopNames;
+        bool isHidden { false };
+        bool isNoDisplay { false };
+    };
+
+    static const DesktopEntry *desktopEntry(const QString &path)
+    {
+        static QHash<QString, DesktopEntry> cache;
+
+        QFileInfo info(path);
+        if (!info.isFile()) {
+            cache.remove(path);
+            return nullptr;
+        }
+
+        // reuse the cached entry as long as the file is unchanged
+        auto it = cache.constFind(path);
+        if (it != cache.constEnd() && it->lastModified == info.lastModified() && it->size == info.size())
+            return &it.value();
+
+        qCDebug(lcConfig) << "Reading from" << path;
+
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly))
+            return nullptr;
+
+        DesktopEntry entry;
+        entry.lastModified = info.lastModified();
+        entry.size = info.size();
+
+        QString current_section;
+
+        QTextStream in(&file);
+        while (!in.atEnd()) {
+            QString line = in.readLine();
+
+            if (line.startsWith(QLatin1String("["))) {
+                // The section name ends before the last ] before the start of a comment
+                int end = line.lastIndexOf(QLatin1Char(']'), line.indexOf(QLatin1Char('#')));
+                if (end != -1)
+                    current_section = line.mid(1, end - 1);
+            }
+
+            if (current_section != QLatin1String("Desktop Entry"))
+                continue; // We are only interested in the "Desktop Entry" section
+
+            if (line.startsWith(QLatin1String("Name=")))
+                entry.name = line.mid(5);
+            if (line.startsWith(QLatin1String("Comment=")))
+                entry.comment = line.mid(8);
+            if (line.startsWith(QLatin1String("Exec=")))
+                entry.exec = line.mid(5);
+            if (line.startsWith(QStringLiteral("TryExec=")))
+                entry.tryExec = line.mid(8);
+            if (line.startsWith(QLatin1String("DesktopNames=")))
+                entry.desktopNames = line.mid(13).replace(QLatin1Char(';'), QLatin1Char(':'));
+            if (line.startsWith(QLatin1String("Hidden=")))
+                entry.isHidden = line.mid(7).toLower() == QLatin1String("true");
+            if (line.startsWith(QLatin1String("NoDisplay=")))
+                entry.isNoDisplay = line.mid(10).toLower() == QLatin1String("true");
+        }
+
+        file.close();
+
+        return &cache.insert(path, entry).value();
+    }
+
     Session::Session()
         : m_valid(false)
         , m_type(UnknownSession)
@@ -113,11 +194,15 @@ namespace SDDM {
         if (!fileName.endsWith(s_entryExtention))
             fileName += s_entryExtention;
 
-        QFileInfo info(fileName);
-
         m_type = UnknownSession;
         m_valid = false;
+        m_displayName.clear();
+        m_comment.clear();
+        m_exec.clear();
+        m_tryExec.clear();
         m_desktopNames.clear();
+        m_isHidden = false;
+        m_isNoDisplay = false;
 
         switch (type) {
         case WaylandSession:
@@ -135,60 +220,26 @@ namespace SDDM {
 
         m_fileName = m_dir.absoluteFilePath(fileName);
 
-        qDebug() << "Reading from" << m_fileName;
-
-        QFile file(m_fileName);
-        if (!file.open(QIODevice::ReadOnly))
+        const DesktopEntry *entry = desktopEntry(m_fileName);
+        if (!entry)
             return;
 
-        QString current_section;
-
-        QTextStream in(&file);
-        while (!in.atEnd()) {
-            QString line = in.readLine();
-
-            if (line.startsWith(QLatin1String("["))) {
-                // The section name ends before the last ] before the start of a comment
-                int end = line.lastIndexOf(QLatin1Char(']'), line.indexOf(QLatin1Char('#')));
-                if (end != -1)
-                    current_section = line.mid(1, end - 1);
-            }
-
-            if (current_section != QLatin1String("Desktop Entry"))
-                continue; // We are only interested in the "Desktop Entry" section
-
-            if (line.startsWith(QLatin1String("Name="))) {
-                if (type == WaylandSession)
-                    if (line.mid(5).endsWith(QLatin1String(" (Wayland)")))
-                        m_displayName = QObject::tr("%1").arg(line.mid(5));
-                    else
-                        m_displayName = QObject::tr("%1 (Wayland)").arg(line.mid(5));
-                else
-                    m_displayName = line.mid(5);
-            }
-            if (line.startsWith(QLatin1String("Comment=")))
-                m_comment = line.mid(8);
-            if (line.startsWith(QLatin1String("Exec=")))
-                m_exec = line.mid(5);
-            if (line.startsWith(QStringLiteral("TryExec=")))
-                m_tryExec = line.mid(8);
-            if (line.startsWith(QLatin1String("DesktopNames=")))
-                m_desktopNames = line.mid(13).replace(QLatin1Char(';'), QLatin1Char(':'));
-            if (line.startsWith(QLatin1String("Hidden=")))
-                m_isHidden = line.mid(7).toLower() == QLatin1String("true");
-            if (line.startsWith(QLatin1String("NoDisplay=")))
-                m_isNoDisplay = line.mid(10).toLower() == QLatin1String("true");
+        if (type == WaylandSession) {
+            if (entry->name.endsWith(QLatin1String(" (Wayland)")))
+                m_displayName = QObject::tr("%1").arg(entry->name);
+            else
+                m_displayName = QObject::tr("%1 (Wayland)").arg(entry->name);
+        } else {
+            m_displayName = entry->name;
         }
-
-        file.close();
+        m_comment = entry->comment;
+        m_exec = entry->exec;
+        m_tryExec = entry->tryExec;
+        m_desktopNames = entry->desktopNames;
+        m_isHidden = entry->isHidden;
+        m_isNoDisplay = entry->isNoDisplay;
 
         m_type = type;
         m_valid = true;
     }
-
-    Session &Session::operator=(const Session &other)
-    {
-        setTo(other.type(), other.fileName());
-        return *this;
-    }
 }
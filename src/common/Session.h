@@ -27,6 +27,8 @@
 namespace SDDM {
     class SessionModel;
 
+    // Session is a plain value type, copying it never touches the disk.
+    // Desktop entries are parsed once and cached until the file changes.
     class Session {
     public:
         enum Type {
@@ -61,8 +63,6 @@ namespace SDDM {
 
         void setTo(Type type, const QString &name);
 
-        Session &operator=(const Session &other);
-
     private:
         bool m_valid;
         Type m_type;
@@ -0,0 +1,72 @@
+/***************************************************************************
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+
+#include "SocketReader.h"
+
+#include <QtEndian>
+
+namespace SDDM {
+    void SocketReader::append(const QByteArray &data) {
+        m_buffer.append(data);
+    }
+
+    bool SocketReader::next(QByteArray &message) {
+        if (m_error)
+            return false;
+
+        // wait for the length
+        const int available = m_buffer.size() - m_offset;
+        if (available < int(sizeof(quint32)))
+            return false;
+
+        const quint32 length = qFromBigEndian<quint32>(reinterpret_cast<const uchar *>(m_buffer.constData() + m_offset));
+        if (length > quint32(MaxMessageSize)) {
+            m_error = true;
+            return false;
+        }
+
+        // wait for the payload
+        if (available - int(sizeof(quint32)) < int(length))
+            return false;
+
+        message = m_buffer.mid(m_offset + int(sizeof(quint32)), int(length));
+        m_offset += int(sizeof(quint32)) + int(length);
+
+        // drop what was consumed
+        if (m_offset == m_buffer.size()) {
+            m_buffer.clear();
+            m_offset = 0;
+        } else if (m_offset >= 4096) {
+            m_buffer.remove(0, m_offset);
+            m_offset = 0;
+        }
+
+        return true;
+    }
+
+    bool SocketReader::hasError() const {
+        return m_error;
+    }
+
+    void SocketReader::clear() {
+        m_buffer.clear();
+        m_offset = 0;
+        m_error = false;
+    }
+}
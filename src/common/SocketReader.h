@@ -0,0 +1,51 @@
+/***************************************************************************
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+
+#ifndef SDDM_SOCKETREADER_H
+#define SDDM_SOCKETREADER_H
+
+#include <QByteArray>
+
+namespace SDDM {
+    /**
+     * Splits the byte stream of a greeter socket back into messages.
+     *
+     * Every message is sent by SocketWriter as a big-endian quint32 length
+     * followed by that many bytes of payload. Data can be appended in
+     * chunks of any size, next() only returns complete messages.
+     */
+    class SocketReader {
+    public:
+        // anything bigger means the stream is broken
+        static const int MaxMessageSize = 1024 * 1024;
+
+        void append(const QByteArray &data);
+        bool next(QByteArray &message);
+
+        bool hasError() const;
+        void clear();
+
+    private:
+        QByteArray m_buffer;
+        int m_offset { 0 };
+        bool m_error { false };
+    };
+}
+
+#endif // SDDM_SOCKETREADER_H
@@ -20,18 +20,45 @@
 
 #include "SocketWriter.h"
 
+#include "Messages.h"
+
 namespace SDDM {
     SocketWriter::SocketWriter(QLocalSocket *socket) : socket(socket) {
-        output = new QDataStream(&data, QIODevice::WriteOnly);
+        output = new QDataStream(&message, QIODevice::WriteOnly);
+        output->setVersion(ProtocolStreamVersion);
     }
 
     SocketWriter::~SocketWriter() {
+        nextMessage();
+
         socket->write(data);
         socket->flush();
 
         delete output;
     }
 
+    SocketWriter &SocketWriter::nextMessage() {
+        if (message.isEmpty())
+            return *this;
+
+        // close the current message and start a new one
+        data.append(frame(message));
+
+        delete output;
+        message.clear();
+        output = new QDataStream(&message, QIODevice::WriteOnly);
+        output->setVersion(ProtocolStreamVersion);
+
+        return *this;
+    }
+
+    QByteArray SocketWriter::frame(const QByteArray &message) {
+        QByteArray result;
+        QDataStream(&result, QIODevice::WriteOnly) << quint32(message.size());
+        result.append(message);
+        return result;
+    }
+
     SocketWriter &SocketWriter::operator << (const quint32 &u) {
         *output << u;
 
@@ -27,6 +27,12 @@
 #include "Session.h"
 
 namespace SDDM {
+    /**
+     * Writes messages to a greeter socket, each one prefixed by its length.
+     *
+     * Messages started with nextMessage() are corked together and handed to
+     * the socket in a single write when the writer goes out of scope.
+     */
     class SocketWriter {
         Q_DISABLE_COPY(SocketWriter)
     public:
@@ -37,8 +43,13 @@ namespace SDDM {
         SocketWriter &operator << (const QString &s);
         SocketWriter &operator << (const Session &s);
 
+        SocketWriter &nextMessage();
+
+        static QByteArray frame(const QByteArray &message);
+
     private:
         QByteArray data;
+        QByteArray message;
         QDataStream *output;
         QLocalSocket *socket;
     };
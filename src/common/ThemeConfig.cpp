@@ -21,44 +21,76 @@
 
 #include "ThemeConfig.h"
 
+#include "ConfigReader.h"
+#include "LogCategories.h"
+
+#include <QDateTime>
 #include <QDebug>
-#include <QSettings>
+#include <QFileInfo>
+#include <QHash>
 #include <QStringList>
 
 namespace SDDM {
+    struct ThemeConfigFile {
+        QDateTime lastModified;
+        QDateTime userLastModified;
+        QVariantMap values;
+    };
+
+    // keys outside of the General section are prefixed with their
+    // section like QSettings does
+    static QVariantMap readThemeConfigFile(const QString &path) {
+        QVariantMap values;
+        readIniFile(path, [&values](const QString &section, const QString &key, const QString &value) {
+            if (section == QLatin1String(IMPLICIT_SECTION))
+                values.insert(key, parseIniValue(value));
+            else
+                values.insert(section + QLatin1Char('/') + key, parseIniValue(value));
+        });
+        return values;
+    }
+
     ThemeConfig::ThemeConfig(const QString &path) {
         setTo(path);
     }
 
     void ThemeConfig::setTo(const QString &path) {
-        clear();
+        // both the daemon and the greeter read the same files over and over,
+        // only parse them again when one of them changed
+        static QHash<QString, ThemeConfigFile> cache;
 
-        qDebug() << "Loading theme configuration from" << path;
+        const QString userPath = path + QStringLiteral(".user");
+        const QDateTime lastModified = QFileInfo(path).lastModified();
+        const QDateTime userLastModified = QFileInfo(userPath).lastModified();
 
-        QSettings settings(path, QSettings::IniFormat);
-        QSettings userSettings(path + QStringLiteral(".user"), QSettings::IniFormat);
+        auto it = cache.find(path);
+        if (it == cache.end() || it->lastModified != lastModified || it->userLastModified != userLastModified) {
+            qCDebug(lcConfig) << "Loading theme configuration from" << path;
 
-        // Support non-latin strings in background picture path
-        // Warning: The codec must be set immediately after creating the QSettings object,
-        // before accessing any data.
-        settings.setIniCodec("UTF-8");
-        userSettings.setIniCodec("UTF-8");
+            ThemeConfigFile file;
+            file.lastModified = lastModified;
+            file.userLastModified = userLastModified;
 
-        // read default keys
-        for (const QString &key: settings.allKeys()) {
-            insert(key, settings.value(key));
-        }
-        // read user set themes overwriting defaults if they exist
-        for (const QString &key: userSettings.allKeys()) {
-            if (!userSettings.value(key).toString().isEmpty()) {
-                insert(key, userSettings.value(key));
+            // read default keys
+            const QVariantMap settings = readThemeConfigFile(path);
+            file.values = settings;
+
+            // read user set themes overwriting defaults if they exist
+            const QVariantMap userSettings = readThemeConfigFile(userPath);
+            for (auto user = userSettings.constBegin(); user != userSettings.constEnd(); ++user) {
+                if (!user.value().toString().isEmpty())
+                    file.values.insert(user.key(), user.value());
             }
-        }
 
-        //if the main config contains a background, save this to a new config value
-        //to themes can use it if the user set config background cannot be loaded
-        if (settings.contains(QStringLiteral("background"))) {
-            insert(QStringLiteral("defaultBackground"), settings.value(QStringLiteral("background")));
+            //if the main config contains a background, save this to a new config value
+            //to themes can use it if the user set config background cannot be loaded
+            if (settings.contains(QStringLiteral("background"))) {
+                file.values.insert(QStringLiteral("defaultBackground"), settings.value(QStringLiteral("background")));
+            }
+
+            it = cache.insert(path, file);
         }
+
+        QVariantMap::operator=(it->values);
     }
 }
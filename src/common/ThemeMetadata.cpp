@@ -19,15 +19,19 @@
 ***************************************************************************/
 
 #include "ThemeMetadata.h"
+#include "ConfigReader.h"
 
-#include <QSettings>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QHash>
 
 namespace SDDM {
     class ThemeMetadataPrivate {
     public:
         QString mainScript { QStringLiteral("Main.qml") };
-        QString configFile;
+        QString configFile { QStringLiteral("theme.conf") };
         QString translationsDirectory { QStringLiteral(".") };
+        QDateTime lastModified;
     };
 
     ThemeMetadata::ThemeMetadata(const QString &path, QObject *parent) : QObject(parent), d(new ThemeMetadataPrivate()) {
@@ -51,10 +55,32 @@ namespace SDDM {
     }
 
     void ThemeMetadata::setTo(const QString &path) {
-        QSettings settings(path, QSettings::IniFormat);
-        // read values
-        d->mainScript = settings.value(QStringLiteral("SddmGreeterTheme/MainScript"), QStringLiteral("Main.qml")).toString();
-        d->configFile = settings.value(QStringLiteral("SddmGreeterTheme/ConfigFile"), QStringLiteral("theme.conf")).toString();
-        d->translationsDirectory = settings.value(QStringLiteral("SddmGreeterTheme/TranslationsDirectory"), QStringLiteral(".")).toString();
+        // only parse the file again when it changed
+        static QHash<QString, ThemeMetadataPrivate> cache;
+
+        const QDateTime lastModified = QFileInfo(path).lastModified();
+
+        auto it = cache.find(path);
+        if (it == cache.end() || it->lastModified != lastModified) {
+            ThemeMetadataPrivate metadata;
+            metadata.lastModified = lastModified;
+
+            // read values
+            readIniFile(path, [&metadata](const QString &section, const QString &key, const QString &value) {
+                if (section != QLatin1String("SddmGreeterTheme"))
+                    return;
+
+                if (key == QLatin1String("MainScript"))
+                    metadata.mainScript = parseIniValue(value).toString();
+                else if (key == QLatin1String("ConfigFile"))
+                    metadata.configFile = parseIniValue(value).toString();
+                else if (key == QLatin1String("TranslationsDirectory"))
+                    metadata.translationsDirectory = parseIniValue(value).toString();
+            });
+
+            it = cache.insert(path, metadata);
+        }
+
+        *d = *it;
     }
 }
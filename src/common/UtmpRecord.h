@@ -0,0 +1,65 @@
+/***************************************************************************
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+
+#ifndef SDDM_UTMPRECORD_H
+#define SDDM_UTMPRECORD_H
+
+#include <QDataStream>
+#include <QString>
+
+namespace SDDM {
+    /**
+     * Login accounting event, recorded by sddm-helper and written to
+     * utmp, wtmp and btmp by the daemon.
+     */
+    class UtmpRecord {
+    public:
+        enum Type {
+            Login = 0,
+            Logout,
+            FailedLogin
+        };
+
+        Type type { Login };
+        QString vt;
+        QString displayName;
+        QString user;
+        qint64 pid { 0 };
+        qint64 seconds { 0 };
+        qint64 microseconds { 0 };
+    };
+
+    inline QDataStream &operator<<(QDataStream &s, const UtmpRecord &r) {
+        s << qint32(r.type) << r.vt << r.displayName << r.user << r.pid << r.seconds << r.microseconds;
+        return s;
+    }
+
+    inline QDataStream &operator>>(QDataStream &s, UtmpRecord &r) {
+        qint32 type;
+        s >> type >> r.vt >> r.displayName >> r.user >> r.pid >> r.seconds >> r.microseconds;
+        if (type < UtmpRecord::Login || type > UtmpRecord::FailedLogin) {
+            s.setStatus(QDataStream::ReadCorruptData);
+            return s;
+        }
+        r.type = UtmpRecord::Type(type);
+        return s;
+    }
+}
+
+#endif // SDDM_UTMPRECORD_H
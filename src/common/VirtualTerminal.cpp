@@ -18,8 +18,10 @@
 ***************************************************************************/
 
 #include <QDebug>
+#include <QMap>
 #include <QString>
 
+#include "Constants.h"
 #include "VirtualTerminal.h"
 
 #include <errno.h>
@@ -29,7 +31,9 @@
 #include <signal.h>
 #include <linux/vt.h>
 #include <linux/kd.h>
+#include <sys/file.h>
 #include <sys/ioctl.h>
+#include <sys/stat.h>
 
 #define RELEASE_DISPLAY_SIGNAL (SIGRTMAX)
 #define ACQUIRE_DISPLAY_SIGNAL (SIGRTMAX - 1)
@@ -115,42 +119,154 @@ out:
                 qDebug() << "VT mode didn't need to be fixed";
         }
 
-        int setUpNewVt() {
-            // open VT master
-            int fd = open("/dev/tty0", O_RDWR | O_NOCTTY);
-            if (fd < 0) {
-                qCritical() << "Failed to open VT master:" << strerror(errno);
+        typedef QMap<int, pid_t> Reservations;
+
+        static const char reservationsPath[] = RUNTIME_DIR "/vt-reservations";
+
+        // opens and locks the reservation file, -1 if that's not possible
+        static int lockReservations() {
+            mkdir(RUNTIME_DIR, 0755);
+            int fd = open(reservationsPath, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+            if (fd < 0)
                 return -1;
-            }
 
-            vt_stat vtState = { 0 };
-            if (ioctl(fd, VT_GETSTATE, &vtState) < 0) {
-                qCritical() << "Failed to get current VT:" << strerror(errno);
+            if (flock(fd, LOCK_EX) < 0) {
                 close(fd);
                 return -1;
             }
 
-            int vt = 0;
-            if (ioctl(fd, VT_OPENQRY, &vt) < 0) {
-                qCritical() << "Failed to open new VT:" << strerror(errno);
+            return fd;
+        }
+
+        static void unlockReservations(int fd) {
+            if (fd < 0)
+                return;
+            flock(fd, LOCK_UN);
+            close(fd);
+        }
+
+        // one "vt pid" line per reservation
+        static Reservations readReservations(int fd) {
+            Reservations reservations;
+            if (fd < 0)
+                return reservations;
+
+            QByteArray data;
+            char buffer[512];
+            ssize_t length;
+            lseek(fd, 0, SEEK_SET);
+            while ((length = read(fd, buffer, sizeof(buffer))) > 0)
+                data.append(buffer, length);
+
+            for (const QByteArray &line : data.split('\n')) {
+                const QList<QByteArray> fields = line.split(' ');
+                if (fields.size() != 2)
+                    continue;
+
+                int vt = fields[0].toInt();
+                pid_t pid = fields[1].toInt();
+
+                // whoever reserved it is gone
+                if (vt <= 0 || pid <= 0 || (kill(pid, 0) < 0 && errno == ESRCH))
+                    continue;
+
+                reservations.insert(vt, pid);
+            }
+
+            return reservations;
+        }
+
+        static void writeReservations(int fd, const Reservations &reservations) {
+            if (fd < 0)
+                return;
+
+            QByteArray data;
+            for (auto it = reservations.constBegin(); it != reservations.constEnd(); ++it)
+                data += QByteArray::number(it.key()) + ' ' + QByteArray::number(it.value()) + '\n';
+
+            if (ftruncate(fd, 0) < 0 || lseek(fd, 0, SEEK_SET) < 0 ||
+                    write(fd, data.constData(), data.size()) != data.size())
+                qWarning() << "Failed to write VT reservations:" << strerror(errno);
+        }
+
+        int allocateVt(int minimum) {
+            // VT_OPENQRY: lowest VT nobody has open,
+            // VT_GETSTATE: allocated VTs among the first 16
+            int firstFree = -1;
+            vt_stat vtState = { 0 };
+            int fd = open("/dev/tty0", O_RDWR | O_NOCTTY);
+            if (fd < 0) {
+                qWarning("Failed to open /dev/tty0: %s", strerror(errno));
+                return -1;
+            }
+            if (ioctl(fd, VT_OPENQRY, &firstFree) < 0 || ioctl(fd, VT_GETSTATE, &vtState) < 0) {
+                qWarning("Failed to query the VT state: %s", strerror(errno));
                 close(fd);
                 return -1;
             }
-
             close(fd);
 
-            // fallback to active VT
-            if (vt <= 0) {
-                qWarning() << "New VT" << vt << "is not valid, fall back to" << vtState.v_active;
-                return vtState.v_active;
+            // every VT is open
+            if (firstFree <= 0)
+                return -1;
+
+            int lockFd = lockReservations();
+            Reservations reservations = readReservations(lockFd);
+
+            int vt = -1;
+            for (int candidate = qMax(minimum, 1); candidate <= MAX_NR_CONSOLES; candidate++) {
+                // everything below the first free VT is open, above it a
+                // VT that was never allocated is certainly free
+                bool used = reservations.contains(candidate) || candidate < firstFree;
+                if (!used && candidate > firstFree && candidate < 16)
+                    used = vtState.v_state & (1 << candidate);
+
+                if (!used) {
+                    vt = candidate;
+                    break;
+                }
+            }
+
+            if (vt < 0) {
+                unlockReservations(lockFd);
+                return -1;
             }
 
+            reservations.insert(vt, getpid());
+            writeReservations(lockFd, reservations);
+            unlockReservations(lockFd);
+
             return vt;
         }
 
-        void jumpToVt(int vt, bool vt_auto) {
-            qDebug() << "Jumping to VT" << vt;
+        void reserveVt(int vt) {
+            int fd = lockReservations();
+            Reservations reservations = readReservations(fd);
+            if (reservations.value(vt, getpid()) != getpid())
+                qWarning() << "VT" << vt << "is already reserved by" << reservations.value(vt);
+            reservations.insert(vt, getpid());
+            writeReservations(fd, reservations);
+            unlockReservations(fd);
+        }
+
+        void releaseVt(int vt) {
+            int fd = lockReservations();
+            Reservations reservations = readReservations(fd);
+            reservations.remove(vt);
+            writeReservations(fd, reservations);
+            unlockReservations(fd);
+        }
+
+        int setUpNewVt() {
+            // same as VT_OPENQRY, but also skipping VTs the daemon or
+            // other helpers reserved and nobody has opened yet
+            return allocateVt(1);
+        }
+
+        bool activateVt(int vt, bool vt_auto) {
+            qDebug() << "Activating VT" << vt;
 
+            bool ok = true;
             int fd;
 
             int activeVtFd = open("/dev/tty0", O_RDWR | O_NOCTTY);
@@ -181,14 +297,64 @@ out:
             if (!vt_auto)
                 handleVtSwitches(fd);
 
-            if (ioctl(fd, VT_ACTIVATE, vt) < 0)
+            if (ioctl(fd, VT_ACTIVATE, vt) < 0) {
                 qWarning("Couldn't initiate jump to VT %d: %s", vt, strerror(errno));
-            else if (ioctl(fd, VT_WAITACTIVE, vt) < 0)
-                qWarning("Couldn't finalize jump to VT %d: %s", vt, strerror(errno));
+                ok = false;
+            }
 
             close(activeVtFd);
             if (vtFd != -1)
                 close(vtFd);
+
+            return ok;
+        }
+
+        void jumpToVt(int vt, bool vt_auto) {
+            qDebug() << "Jumping to VT" << vt;
+
+            if (!activateVt(vt, vt_auto))
+                return;
+
+            int fd = open("/dev/tty0", O_RDWR | O_NOCTTY);
+            if (ioctl(fd, VT_WAITACTIVE, vt) < 0)
+                qWarning("Couldn't finalize jump to VT %d: %s", vt, strerror(errno));
+            close(fd);
+        }
+
+        int activeVt() {
+            int fd = open("/dev/tty0", O_RDWR | O_NOCTTY);
+            if (fd < 0)
+                return -1;
+
+            vt_stat vtState = { 0 };
+            int result = ioctl(fd, VT_GETSTATE, &vtState);
+            close(fd);
+
+            return result < 0 ? -1 : vtState.v_active;
+        }
+
+        int waitForSwitch() {
+#if defined(VT_WAITEVENT)
+            int fd = open("/dev/tty0", O_RDWR | O_NOCTTY);
+            if (fd < 0)
+                return 0;
+
+            // not restarted after a signal, that's how the caller gets out
+            vt_event event = { 0 };
+            event.event = VT_EVENT_SWITCH;
+            int result = ioctl(fd, VT_WAITEVENT, &event);
+            int error = errno;
+            close(fd);
+
+            if (result < 0)
+                return (error == ENOTTY || error == EINVAL) ? -1 : 0;
+
+            // report what is active now, not what the event said, so an
+            // event missed between two calls is caught up with
+            return activeVt();
+#else
+            return -1;
+#endif
         }
     }
 }
@@ -24,6 +24,24 @@ namespace SDDM {
     namespace VirtualTerminal {
         int setUpNewVt();
         void jumpToVt(int vt, bool vt_auto);
+
+        // lowest VT from minimum on that is neither open according to the
+        // kernel nor reserved, reserved for the calling process; -1 if
+        // the kernel can't be asked or no VT up to 63 is free
+        int allocateVt(int minimum);
+        // reservations are shared by the daemon and the helpers through a
+        // file in the runtime directory, those of dead processes expire
+        void reserveVt(int vt);
+        void releaseVt(int vt);
+
+        // starts switching to vt without waiting for the switch to happen
+        bool activateVt(int vt, bool vt_auto);
+        // currently active VT, -1 if unknown
+        int activeVt();
+        // blocks until the next VT switch and returns the active VT, 0 if
+        // interrupted by a signal or failing for now, -1 if the kernel
+        // doesn't report VT events
+        int waitForSwitch();
     }
 }
 
@@ -18,6 +18,7 @@
 ***************************************************************************/
 
 #include <QDebug>
+#include <QSet>
 #include <QString>
 
 #include "VirtualTerminal.h"
@@ -33,5 +34,37 @@ namespace SDDM {
         void jumpToVt(int vt, bool vt_auto) {
             qDebug() << "Jumping to VT" << vt << "is unsupported on FreeBSD";
         }
+
+        // no kernel state to consult, only keep track of this process
+        static QSet<int> reservations;
+
+        int allocateVt(int minimum) {
+            int vt = minimum;
+            while (reservations.contains(vt))
+                vt++;
+            reservations.insert(vt);
+            return vt;
+        }
+
+        void reserveVt(int vt) {
+            reservations.insert(vt);
+        }
+
+        void releaseVt(int vt) {
+            reservations.remove(vt);
+        }
+
+        bool activateVt(int vt, bool vt_auto) {
+            qDebug() << "Jumping to VT" << vt << "is unsupported on FreeBSD";
+            return false;
+        }
+
+        int activeVt() {
+            return -1;
+        }
+
+        int waitForSwitch() {
+            return -1;
+        }
     }
 }
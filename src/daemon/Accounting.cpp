@@ -0,0 +1,217 @@
+/***************************************************************************
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+
+#include "Accounting.h"
+
+#include "Constants.h"
+#include "DaemonApp.h"
+#include "LogCategories.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QTimer>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <utmpx.h>
+
+namespace SDDM {
+    // records arriving within this window are written together
+    static const int FlushInterval = 250;
+
+    struct SpoolEntry {
+        qint32 type;
+        struct utmpx entry;
+    };
+
+    static QString spoolPath() {
+        // use "." in test mode, like the X authority files
+        QString dir = daemonApp->testing() ? QStringLiteral(".") : QStringLiteral(RUNTIME_DIR);
+        QDir().mkpath(dir);
+        return QStringLiteral("%1/accounting.spool").arg(dir);
+    }
+
+    static SpoolEntry toSpoolEntry(const UtmpRecord &record) {
+        SpoolEntry spool;
+        memset(&spool, 0, sizeof(spool));
+        spool.type = record.type;
+
+        struct utmpx &entry = spool.entry;
+        entry.ut_type = record.type == UtmpRecord::Logout ? DEAD_PROCESS : USER_PROCESS;
+        entry.ut_pid = record.pid;
+
+        // ut_line: vt
+        if (!record.vt.isEmpty()) {
+            QByteArray tty = QStringLiteral("tty%1").arg(record.vt).toLocal8Bit();
+            strncpy(entry.ut_line, tty.constData(), sizeof(entry.ut_line) - 1);
+        }
+
+        // ut_host: displayName
+        QByteArray display = record.displayName.toLocal8Bit();
+        strncpy(entry.ut_host, display.constData(), sizeof(entry.ut_host) - 1);
+
+        // ut_user: user
+        QByteArray user = record.user.toLocal8Bit();
+        strncpy(entry.ut_user, user.constData(), sizeof(entry.ut_user) - 1);
+
+        entry.ut_tv.tv_sec = record.seconds;
+        entry.ut_tv.tv_usec = record.microseconds;
+
+        return spool;
+    }
+
+    static bool writeAll(int fd, const char *data, size_t length) {
+        while (length > 0) {
+            ssize_t written = ::write(fd, data, length);
+            if (written < 0) {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            data += written;
+            length -= written;
+        }
+        return true;
+    }
+
+#if defined(Q_OS_LINUX)
+    // same as updwtmpx(), but for a whole batch: one open, one lock and
+    // one write no matter how many records are queued
+    static void appendDatabase(const char *path, const QVector<struct utmpx> &entries) {
+        if (entries.isEmpty())
+            return;
+
+        // like updwtmpx(), don't create a database the system doesn't keep
+        int fd = ::open(path, O_WRONLY | O_APPEND | O_CLOEXEC);
+        if (fd < 0) {
+            if (errno != ENOENT)
+                qCWarning(lcAuth) << "Failed to open" << path << ":" << strerror(errno);
+            return;
+        }
+
+        struct flock lock;
+        memset(&lock, 0, sizeof(lock));
+        lock.l_type = F_WRLCK;
+        lock.l_whence = SEEK_SET;
+        if (fcntl(fd, F_SETLKW, &lock) < 0) {
+            qCWarning(lcAuth) << "Failed to lock" << path << ":" << strerror(errno);
+            ::close(fd);
+            return;
+        }
+
+        if (!writeAll(fd, reinterpret_cast<const char *>(entries.constData()), entries.size() * sizeof(struct utmpx)))
+            qCWarning(lcAuth) << "Failed to write" << path << ":" << strerror(errno);
+
+        lock.l_type = F_UNLCK;
+        fcntl(fd, F_SETLK, &lock);
+        ::close(fd);
+    }
+#endif
+
+    Accounting::Accounting(QObject *parent) : QObject(parent), m_timer(new QTimer(this)) {
+        m_timer->setSingleShot(true);
+        m_timer->setInterval(FlushInterval);
+        connect(m_timer, &QTimer::timeout, this, &Accounting::flush);
+
+        // records the previous instance accepted but never wrote
+        replaySpool();
+
+        m_spool = ::open(qPrintable(spoolPath()), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+        if (m_spool < 0)
+            qCWarning(lcAuth) << "Failed to open accounting spool:" << strerror(errno);
+
+        flush();
+    }
+
+    Accounting::~Accounting() {
+        flush();
+        if (m_spool >= 0)
+            ::close(m_spool);
+    }
+
+    void Accounting::append(const UtmpRecord &record) {
+        SpoolEntry spool = toSpoolEntry(record);
+
+        // keep it on disk before the helper is gone, the batch is written later
+        if (m_spool >= 0 && !writeAll(m_spool, reinterpret_cast<const char *>(&spool), sizeof(spool)))
+            qCWarning(lcAuth) << "Failed to spool accounting record:" << strerror(errno);
+
+        m_pending.append(spool);
+        if (!m_timer->isActive())
+            m_timer->start();
+    }
+
+    void Accounting::flush() {
+        m_timer->stop();
+
+        if (m_pending.isEmpty())
+            return;
+
+        if (daemonApp->testing()) {
+            qCDebug(lcAuth) << "Test mode, dropping" << m_pending.size() << "accounting records";
+        } else {
+            QVector<struct utmpx> wtmp;
+            QVector<struct utmpx> btmp;
+
+            // write to utmp
+            setutxent();
+            for (const SpoolEntry &spool : qAsConst(m_pending)) {
+                if (!pututxline(&spool.entry))
+                    qCWarning(lcAuth) << "Failed to write utmpx: " << strerror(errno);
+
+                if (spool.type == UtmpRecord::FailedLogin)
+                    btmp.append(spool.entry);
+                else
+                    wtmp.append(spool.entry);
+            }
+            endutxent();
+
+#if defined(Q_OS_LINUX)
+            // append to wtmp and the failed login database btmp
+            appendDatabase("/var/log/wtmp", wtmp);
+            appendDatabase("/var/log/btmp", btmp);
+#endif
+        }
+
+        m_pending.clear();
+
+        // everything is written, start the spool over
+        if (m_spool >= 0 && ftruncate(m_spool, 0) < 0)
+            qCWarning(lcAuth) << "Failed to truncate accounting spool:" << strerror(errno);
+    }
+
+    void Accounting::replaySpool() {
+        int fd = ::open(qPrintable(spoolPath()), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return;
+
+        SpoolEntry spool;
+        while (::read(fd, &spool, sizeof(spool)) == sizeof(spool)) {
+            if (spool.type < UtmpRecord::Login || spool.type > UtmpRecord::FailedLogin)
+                break;
+            m_pending.append(spool);
+        }
+        ::close(fd);
+
+        if (!m_pending.isEmpty())
+            qCDebug(lcAuth) << "Writing" << m_pending.size() << "spooled accounting records";
+    }
+}
@@ -0,0 +1,61 @@
+/***************************************************************************
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+
+#ifndef SDDM_ACCOUNTING_H
+#define SDDM_ACCOUNTING_H
+
+#include <QObject>
+#include <QVector>
+
+#include "UtmpRecord.h"
+
+class QTimer;
+
+namespace SDDM {
+    struct SpoolEntry;
+
+    /**
+     * Single writer for utmp, wtmp and btmp.
+     *
+     * Helpers hand their records over through Auth, each one is appended
+     * to a spool file right away and written to the databases in batches.
+     * Whatever is left in the spool after a crash is written on the next
+     * start.
+     */
+    class Accounting : public QObject {
+        Q_OBJECT
+        Q_DISABLE_COPY(Accounting)
+    public:
+        explicit Accounting(QObject *parent = 0);
+        ~Accounting();
+
+    public slots:
+        void append(const UtmpRecord &record);
+        void flush();
+
+    private:
+        void replaySpool();
+
+        QVector<SpoolEntry> m_pending;
+        QTimer *m_timer { nullptr };
+        int m_spool { -1 };
+    };
+}
+
+#endif // SDDM_ACCOUNTING_H
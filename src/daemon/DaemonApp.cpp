@@ -19,12 +19,16 @@
 
 #include "DaemonApp.h"
 
+#include "Accounting.h"
 #include "Configuration.h"
 #include "Constants.h"
 #include "DisplayManager.h"
+#include "LogCategories.h"
+#include "Metrics.h"
 #include "PowerManager.h"
 #include "SeatManager.h"
 #include "SignalHandler.h"
+#include "VtSwitcher.h"
 
 #include "MessageHandler.h"
 
@@ -43,24 +47,37 @@ namespace SDDM {
 
         qInstallMessageHandler(SDDM::DaemonMessageHandler);
 
+        // select the log categories
+        setLogRules(mainConfig.LogRules.get());
+
         // log message
         qDebug() << "Initializing...";
 
         // set testing parameter
         m_testing = (arguments().indexOf(QStringLiteral("--test-mode")) != -1);
 
+        // create metrics before anything is counted
+        m_metrics = new Metrics(this);
+
+        // create accounting before any helper can report to it
+        m_accounting = new Accounting(this);
+
         // create display manager
         m_displayManager = new DisplayManager(this);
 
         // create power manager
         m_powerManager = new PowerManager(this);
 
+        // create VT switcher
+        m_vtSwitcher = new VtSwitcher(this);
+
         // create seat manager
         m_seatManager = new SeatManager(this);
 
         // connect with display manager
         connect(m_seatManager, &SeatManager::seatCreated, m_displayManager, &DisplayManager::AddSeat);
         connect(m_seatManager, &SeatManager::seatRemoved, m_displayManager, &DisplayManager::RemoveSeat);
+        connect(m_seatManager, &SeatManager::seatHealthChanged, m_displayManager, &DisplayManager::SeatHealthChanged);
 
         // create signal handler
         m_signalHandler = new SignalHandler(this);
@@ -71,6 +88,10 @@ namespace SDDM {
         // quit when SIGINT, SIGTERM received
         connect(m_signalHandler, &SignalHandler::sigintReceived, this, &DaemonApp::quit);
         connect(m_signalHandler, &SignalHandler::sigtermReceived, this, &DaemonApp::quit);
+
+        // toggle debug output when SIGUSR1 received
+        SignalHandler::initializeSigusr1();
+        connect(m_signalHandler, &SignalHandler::sigusr1Received, this, [] { toggleDebugLogging(); });
         // log message
         qDebug() << "Starting...";
 
@@ -78,6 +99,12 @@ namespace SDDM {
         m_seatManager->initialize();
     }
 
+    DaemonApp::~DaemonApp() {
+        // stop the displays while the services they report to still exist
+        delete m_seatManager;
+        m_seatManager = nullptr;
+    }
+
     bool DaemonApp::testing() const {
         return m_testing;
     }
@@ -97,10 +124,18 @@ namespace SDDM {
     }
     
 
+    Accounting *DaemonApp::accounting() const {
+        return m_accounting;
+    }
+
     DisplayManager *DaemonApp::displayManager() const {
         return m_displayManager;
     }
 
+    Metrics *DaemonApp::metrics() const {
+        return m_metrics;
+    }
+
     PowerManager *DaemonApp::powerManager() const {
         return m_powerManager;
     }
@@ -113,6 +148,10 @@ namespace SDDM {
         return m_signalHandler;
     }
 
+    VtSwitcher *DaemonApp::vtSwitcher() const {
+        return m_vtSwitcher;
+    }
+
     int DaemonApp::newSessionId() {
         return m_lastSessionId++;
     }
@@ -26,17 +26,21 @@
 #define daemonApp DaemonApp::instance()
 
 namespace SDDM {
+    class Accounting;
     class Configuration;
     class DisplayManager;
+    class Metrics;
     class PowerManager;
     class SeatManager;
     class SignalHandler;
+    class VtSwitcher;
 
     class DaemonApp : public QCoreApplication {
         Q_OBJECT
         Q_DISABLE_COPY(DaemonApp)
     public:
         explicit DaemonApp(int &argc, char **argv);
+        ~DaemonApp();
 
         static DaemonApp *instance() { return self; }
 
@@ -46,10 +50,13 @@ namespace SDDM {
 
         QString hostName() const;
         bool isFirstSeatRun(QString &seatName);
+        Accounting *accounting() const;
         DisplayManager *displayManager() const;
+        Metrics *metrics() const;
         PowerManager *powerManager() const;
         SeatManager *seatManager() const;
         SignalHandler *signalHandler() const;
+        VtSwitcher *vtSwitcher() const;
 
     public slots:
         int newSessionId();
@@ -61,10 +68,13 @@ namespace SDDM {
         int m_lastSessionId { 0 };
 
         bool m_testing { false };
+        Accounting *m_accounting { nullptr };
         DisplayManager *m_displayManager { nullptr };
+        Metrics *m_metrics { nullptr };
         PowerManager *m_powerManager { nullptr };
         SeatManager *m_seatManager { nullptr };
         SignalHandler *m_signalHandler { nullptr };
+        VtSwitcher *m_vtSwitcher { nullptr };
     };
 }
 
@@ -21,9 +21,13 @@
 
 #include "Display.h"
 
+#include "Accounting.h"
 #include "Configuration.h"
 #include "DaemonApp.h"
 #include "DisplayManager.h"
+#include "LogCategories.h"
+#include "Metrics.h"
+#include "PowerManager.h"
 #include "XorgDisplayServer.h"
 #include "Seat.h"
 #include "SocketServer.h"
@@ -50,28 +54,37 @@
 namespace SDDM {
     Display::Display(const int terminalId, Seat *parent) : QObject(parent),
         m_terminalId(terminalId),
-        m_auth(new Auth(this)),
         m_displayServer(new XorgDisplayServer(this)),
         m_seat(parent),
         m_socketServer(new SocketServer(this)),
         m_greeter(new Greeter(this)) {
 
         // respond to authentication requests
-        m_auth->setVerbose(true);
-        connect(m_auth, &Auth::requestChanged, this, &Display::slotRequestChanged);
-        connect(m_auth, &Auth::authentication, this, &Display::slotAuthenticationFinished);
-        connect(m_auth, &Auth::sessionStarted, this, &Display::slotSessionStarted);
-        connect(m_auth, &Auth::finished, this, &Display::slotHelperFinished);
-        connect(m_auth, &Auth::info, this, &Display::slotAuthInfo);
-        connect(m_auth, &Auth::error, this, &Display::slotAuthError);
+        m_auth = createAuth();
 
         // restart display after display server ended
         connect(m_displayServer, &DisplayServer::started, this, &Display::displayServerStarted);
-        connect(m_displayServer, &DisplayServer::stopped, this, &Display::stop);
+        connect(m_displayServer, &DisplayServer::stopped, this, &Display::displayServerStopped);
 
-        // connect login signal
+        // let the seat decide when to bring a failed greeter back
+        connect(m_greeter, &Greeter::failed, this, &Display::slotGreeterFailed);
+        connect(m_socketServer, &SocketServer::connected, this, &Display::ready);
+
+        // connect login signals
+        connect(m_socketServer, &SocketServer::prepareLogin, this, &Display::prepareLogin);
         connect(m_socketServer, &SocketServer::login, this, &Display::login);
 
+        // log greeter startup timings
+        connect(m_socketServer, &SocketServer::greeterStartup, this, &Display::greeterStartup);
+
+        // power actions requested by the greeter
+        PowerManager *powerManager = daemonApp->powerManager();
+        connect(m_socketServer, &SocketServer::powerOff, powerManager, &PowerManager::powerOff);
+        connect(m_socketServer, &SocketServer::reboot, powerManager, &PowerManager::reboot);
+        connect(m_socketServer, &SocketServer::suspend, powerManager, &PowerManager::suspend);
+        connect(m_socketServer, &SocketServer::hibernate, powerManager, &PowerManager::hibernate);
+        connect(m_socketServer, &SocketServer::hybridSleep, powerManager, &PowerManager::hybridSleep);
+
         // connect login result signals
         connect(this, SIGNAL(loginFailed(QLocalSocket*)), m_socketServer, SLOT(loginFailed(QLocalSocket*)));
         connect(this, SIGNAL(loginSucceeded(QLocalSocket*)), m_socketServer, SLOT(loginSucceeded(QLocalSocket*)));
@@ -101,8 +114,41 @@ namespace SDDM {
         return m_seat;
     }
 
+    bool Display::failed() const {
+        return m_failed;
+    }
+
     bool Display::start() {
-        return m_started || m_displayServer->start();
+        if (m_started)
+            return true;
+
+        m_startTimer.start();
+        daemonApp->metrics()->count(Metrics::DisplayStarts, seat()->name());
+
+        // when the display name is known in advance the greeter is spawned
+        // right away, it loads everything that doesn't need the display
+        // server while that is starting and waits for displayServerStarted()
+        if (mainConfig.X11.PrepareGreeter.get() && !hasAutologin() &&
+                qobject_cast<XorgDisplayServer *>(m_displayServer)->assignDisplay()) {
+            qCDebug(lcDisplay) << "Preparing greeter for display" << m_displayServer->display();
+            m_greeterPrepared = startGreeter(true);
+        }
+
+        if (!m_displayServer->start()) {
+            // the prepared greeter gives up once its socket goes away
+            if (m_greeterPrepared) {
+                m_greeter->stop();
+                m_socketServer->stop();
+                m_greeterPrepared = false;
+            }
+            return false;
+        }
+
+        // start the helper for the first login while the display comes up
+        if (!hasAutologin())
+            prepareAuth();
+
+        return true;
     }
 
     bool Display::attemptAutologin(QString &autologinSession, QString &autologinUserSession) {
@@ -119,7 +165,7 @@ namespace SDDM {
         } else if (findSessionEntry(mainConfig.X11.SessionDir.get(), autologinSession)) {
             sessionType = Session::X11Session;
         } else {
-            qCritical() << "Unable to find autologin session entry" << autologinSession;
+            qCCritical(lcDisplay) << "Unable to find autologin session entry" << autologinSession;
             return false;
         }
 
@@ -127,6 +173,9 @@ namespace SDDM {
         session.setTo(sessionType, autologinSession);
 
         m_auth->setAutologin(true);
+        daemonApp->metrics()->count(Metrics::LoginAttempts, seat()->name());
+        m_authTimer.start();
+        m_reuseSessionId = findReusableSession(autologinUserSession);
         //startAuth(mainConfig.Autologin.User.get(), QString(), session);
         startAuth(autologinUserSession, QString(), session);
 
@@ -142,7 +191,7 @@ namespace SDDM {
         m_displayServer->setupDisplay();
 
         // log message
-        qDebug() << "Display server started.";
+        qCDebug(lcDisplay) << "Display server started.";
 
 //       if ((daemonApp->first || mainConfig.Autologin.Relogin.get()) &&
 //           !mainConfig.Autologin.User.get().isEmpty()) {
@@ -167,7 +216,7 @@ namespace SDDM {
                     session = mainConfig.Autologin.Session.get().at(0);
                 }
             } else {
-                qDebug() << "Seat not configured for autologin : "<<seatName;
+                qCDebug(lcDisplay) << "Seat not configured for autologin : "<<seatName;
             }
         } else {
             int listSize = mainConfig.Autologin.SeatName.get().size();
@@ -179,7 +228,7 @@ namespace SDDM {
             relogin = mainConfig.Autologin.Relogin.get().at(seatListIndex) == QLatin1String("true");
             user = mainConfig.Autologin.User.get().at(seatListIndex);
             session = mainConfig.Autologin.Session.get().at(seatListIndex);
-            qDebug() << "Autologin for " << user << " ,session : " << session << " ,relogin :" << relogin;
+            qCDebug(lcDisplay) << "Autologin for " << user << " ,session : " << session << " ,relogin :" << relogin;
         }
 
         if ((daemonApp->isFirstSeatRun(seatName) || relogin ) &&
@@ -195,29 +244,13 @@ namespace SDDM {
             }
         }
 
-        // start socket server
-        m_socketServer->start(m_displayServer->display());
-
-        if (!daemonApp->testing()) {
-            // change the owner and group of the socket to avoid permission denied errors
-            struct passwd *pw = getpwnam("sddm");
-            if (pw) {
-                if (chown(qPrintable(m_socketServer->socketAddress()), pw->pw_uid, pw->pw_gid) == -1) {
-                    qWarning() << "Failed to change owner of the socket";
-                    return;
-                }
-            }
+        if (m_greeterPrepared) {
+            // the greeter is running already, let it connect
+            m_socketServer->setDisplayReady(m_displayServer->display());
+        } else if (!startGreeter(false)) {
+            return;
         }
 
-        // set greeter params
-        m_greeter->setDisplay(this);
-        m_greeter->setAuthPath(qobject_cast<XorgDisplayServer *>(m_displayServer)->authPath());
-        m_greeter->setSocket(m_socketServer->socketAddress());
-        m_greeter->setTheme(findGreeterTheme());
-
-        // start greeter
-        m_greeter->start();
-
         // reset first flag
         //daemonApp->first = false;
 
@@ -230,6 +263,15 @@ namespace SDDM {
         if (!m_started)
             return;
 
+        // drop the spare helper, without blocking on it
+        if (m_spareAuth) {
+            m_spareAuth->dispose();
+            m_spareAuth = nullptr;
+        }
+        m_preparing = false;
+
+        unregisterSession();
+
         // stop the greeter
         m_greeter->stop();
 
@@ -241,13 +283,48 @@ namespace SDDM {
         m_displayServer->stop();
         m_displayServer->blockSignals(false);
 
-        // reset flag
+        // reset flags
         m_started = false;
+        m_greeterPrepared = false;
 
         // emit signal
         emit stopped();
     }
 
+    void Display::displayServerStopped() {
+        // stop() blocks the signals of the display server, so it went
+        // away on its own
+        m_failed = true;
+        stop();
+    }
+
+    void Display::slotGreeterFailed() {
+        // nobody cares about the greeter of a display that's gone or
+        // that has a user session on it, and a greeter that went down
+        // with its display server is restarted along with it
+        if (m_started && !m_failed && m_registeredSession.isEmpty())
+            emit greeterFailed();
+    }
+
+    bool Display::restartGreeter() {
+        // stopping, the seat takes care of the whole display
+        if (!m_started || m_failed)
+            return true;
+
+        // a user session took over meanwhile, no greeter needed
+        if (!m_registeredSession.isEmpty()) {
+            emit ready();
+            return true;
+        }
+
+        qCDebug(lcDisplay) << "Restarting greeter on display" << m_displayServer->display();
+
+        // the new greeter gets a fresh socket, the display is ready already
+        m_socketServer->stop();
+        m_greeterPrepared = false;
+        return startGreeter(false);
+    }
+
     void Display::login(QLocalSocket *socket,
                         const QString &user, const QString &password,
                         const Session &session) {
@@ -259,10 +336,111 @@ namespace SDDM {
             return;
         }
 
+        daemonApp->metrics()->count(Metrics::LoginAttempts, seat()->name());
+        m_authTimer.start();
+
+        m_reuseSessionId = findReusableSession(user);
+
+        if (m_preparing) {
+            // finish the conversation started by prepareLogin(), unless
+            // the prepared helper would start a session we're going to reuse
+            if (m_preparedUser == user && m_preparedSession == session.fileName() &&
+                    m_auth->isActive() && m_reuseSessionId.isNull()) {
+                qCDebug(lcDisplay) << "Completing the login prepared for" << user;
+                m_preparing = false;
+                m_passPhrase = password;
+                setUpSession(session);
+                slotRequestChanged();
+                return;
+            }
+
+            cancelPreparedLogin();
+        }
+
         // authenticate
         startAuth(user, password, session);
     }
 
+    void Display::prepareLogin(QLocalSocket *socket, const QString &user, const Session &session) {
+        Q_UNUSED(socket);
+
+        if (user.isEmpty() || user == QLatin1String("sddm"))
+            return;
+
+        // nothing changed
+        if (m_preparing && m_preparedUser == user && m_preparedSession == session.fileName())
+            return;
+
+        // the selection changed
+        if (m_preparing)
+            cancelPreparedLogin();
+
+        // a login is already being processed
+        if (m_auth->isActive())
+            return;
+
+        qCDebug(lcDisplay) << "Preparing login for" << user;
+
+        // run PAM up to the first prompt, slotRequestChanged()
+        // holds it there until the password comes in
+        m_preparing = true;
+        m_preparedUser = user;
+        m_preparedSession = session.fileName();
+        startPreparedAuth(user, session);
+
+        if (!m_auth->isActive())
+            m_preparing = false;
+    }
+
+    void Display::cancelPreparedLogin() {
+        qCDebug(lcDisplay) << "Cancelling the login prepared for" << m_preparedUser;
+
+        m_preparing = false;
+        m_preparedUser.clear();
+        m_preparedSession.clear();
+
+        m_auth->cancel();
+    }
+
+    bool Display::hasAutologin() const {
+        const QString seatName = seat()->name();
+        const QStringList seatNames = mainConfig.Autologin.SeatName.get();
+
+        if (seatNames.contains(seatName))
+            return true;
+
+        return seatName == QLatin1String("seat0") && seatNames.isEmpty() &&
+               !mainConfig.Autologin.User.get().isEmpty();
+    }
+
+    bool Display::startGreeter(bool prepare) {
+        // start socket server
+        m_socketServer->setHostName(daemonApp->hostName());
+        m_socketServer->setCapabilities(daemonApp->powerManager()->capabilities());
+        m_socketServer->start(m_displayServer->display());
+
+        if (!daemonApp->testing()) {
+            // change the owner and group of the socket to avoid permission denied errors
+            struct passwd *pw = getpwnam("sddm");
+            if (pw) {
+                if (chown(qPrintable(m_socketServer->socketAddress()), pw->pw_uid, pw->pw_gid) == -1) {
+                    qCWarning(lcDisplay) << "Failed to change owner of the socket";
+                    return false;
+                }
+            }
+        }
+
+        // set greeter params
+        m_greeter->setDisplay(this);
+        m_greeter->setAuthPath(qobject_cast<XorgDisplayServer *>(m_displayServer)->authPath());
+        m_greeter->setSocket(m_socketServer->socketAddress());
+        m_greeter->setTheme(findGreeterTheme());
+        m_greeter->setPrepare(prepare);
+
+        // start greeter
+        return m_greeter->start();
+    }
+
     QString Display::findGreeterTheme() const {
         QString themeName = mainConfig.Theme.Current.get();
 
@@ -278,7 +456,7 @@ namespace SDDM {
             return dir.absoluteFilePath(themeName);
 
         // otherwise use the embedded theme
-        qWarning() << "The configured theme" << themeName << "doesn't exist, using the embedded theme instead";
+        qCWarning(lcDisplay) << "The configured theme" << themeName << "doesn't exist, using the embedded theme instead";
         return QString();
     }
 
@@ -293,48 +471,54 @@ namespace SDDM {
         return dir.exists(fileName);
     }
 
-    void Display::startAuth(const QString &user, const QString &password, const Session &session) {
-
-        if (m_auth->isActive()) {
-            qWarning() << "Existing authentication ongoing, aborting";
-            return;
-        }
-
-        m_passPhrase = password;
-
-        // sanity check
+    bool Display::checkSession(const Session &session) const {
         if (!session.isValid()) {
-            qCritical() << "Invalid session" << session.fileName();
-            return;
+            qCCritical(lcDisplay) << "Invalid session" << session.fileName();
+            return false;
         }
         if (session.xdgSessionType().isEmpty()) {
-            qCritical() << "Failed to find XDG session type for session" << session.fileName();
-            return;
+            qCCritical(lcDisplay) << "Failed to find XDG session type for session" << session.fileName();
+            return false;
         }
         if (session.exec().isEmpty()) {
-            qCritical() << "Failed to find command for session" << session.fileName();
-            return;
+            qCCritical(lcDisplay) << "Failed to find command for session" << session.fileName();
+            return false;
         }
+        return true;
+    }
 
-        m_reuseSessionId = QString();
-
-        if (Logind::isAvailable() && mainConfig.Users.ReuseSession.get()) {
-            OrgFreedesktopLogin1ManagerInterface manager(Logind::serviceName(), Logind::managerPath(), QDBusConnection::systemBus());
-            auto reply = manager.ListSessions();
-            reply.waitForFinished();
-
-            const auto info = reply.value();
-            for(const SessionInfo &s : reply.value()) {
-                if (s.userName == user) {
-                    OrgFreedesktopLogin1SessionInterface session(Logind::serviceName(), s.sessionPath.path(), QDBusConnection::systemBus());
-                    if (session.service() == QLatin1String("sddm") && session.state() == QLatin1String("online")) {
-                        m_reuseSessionId = s.sessionId;
-                        break;
-                    }
-                }
+    QString Display::findReusableSession(const QString &user) const {
+        if (!Logind::isAvailable() || !mainConfig.Users.ReuseSession.get())
+            return QString();
+
+        OrgFreedesktopLogin1ManagerInterface manager(Logind::serviceName(), Logind::managerPath(), QDBusConnection::systemBus());
+        auto reply = manager.ListSessions();
+        BlockingCall blocking("logind-list-sessions");
+        reply.waitForFinished();
+
+        for(const SessionInfo &s : reply.value()) {
+            if (s.userName == user) {
+                OrgFreedesktopLogin1SessionInterface session(Logind::serviceName(), s.sessionPath.path(), QDBusConnection::systemBus());
+                if (session.service() == QLatin1String("sddm") && session.state() == QLatin1String("online"))
+                    return s.sessionId;
             }
         }
 
+        return QString();
+    }
+
+    void Display::takeSpareAuth() {
+        // hand the login over to the helper started ahead of time
+        if (m_spareAuth) {
+            m_spareAuth->setAutologin(m_auth->autologin());
+            // a cancelled helper may still be cleaning up
+            m_auth->dispose();
+            m_auth = m_spareAuth;
+            m_spareAuth = nullptr;
+        }
+    }
+
+    void Display::setUpSession(const Session &session) {
         // cache last session
         m_lastSession = session;
 
@@ -343,7 +527,7 @@ namespace SDDM {
         m_sessionName = session.fileName();
 
         // some information
-        qDebug() << "Session" << m_sessionName << "selected, command:" << session.exec();
+        qCDebug(lcDisplay) << "Session" << m_sessionName << "selected, command:" << session.exec();
 
         QProcessEnvironment env;
 
@@ -356,7 +540,8 @@ namespace SDDM {
         if (session.xdgSessionType() == QLatin1String("x11"))
             env.insert(QStringLiteral("DISPLAY"), name());
         env.insert(QStringLiteral("XDG_SEAT_PATH"), daemonApp->displayManager()->seatPath(seat()->name()));
-        env.insert(QStringLiteral("XDG_SESSION_PATH"), daemonApp->displayManager()->sessionPath(QStringLiteral("Session%1").arg(daemonApp->newSessionId())));
+        m_displayManagerSession = QStringLiteral("Session%1").arg(daemonApp->newSessionId());
+        env.insert(QStringLiteral("XDG_SESSION_PATH"), daemonApp->displayManager()->sessionPath(m_displayManagerSession));
         env.insert(QStringLiteral("DESKTOP_SESSION"), session.desktopSession());
         env.insert(QStringLiteral("XDG_CURRENT_DESKTOP"), session.desktopNames());
         env.insert(QStringLiteral("XDG_SESSION_CLASS"), QStringLiteral("user"));
@@ -364,18 +549,98 @@ namespace SDDM {
         env.insert(QStringLiteral("XDG_SEAT"), seat()->name());
         env.insert(QStringLiteral("XDG_SESSION_DESKTOP"), session.desktopNames());
 
+        // the helper gets it along with the authentication result
         m_auth->insertEnvironment(env);
+    }
+
+    void Display::startAuth(const QString &user, const QString &password, const Session &session) {
+
+        if (m_auth->isActive()) {
+            qCWarning(lcDisplay) << "Existing authentication ongoing, aborting";
+            return;
+        }
+
+        m_passPhrase = password;
+
+        // sanity check
+        if (!checkSession(session))
+            return;
+
+        takeSpareAuth();
+        setUpSession(session);
 
         m_auth->setUser(user);
         if (m_reuseSessionId.isNull()) {
             m_auth->setSession(session.exec());
         }
         m_auth->start();
+
+        // and have the next one ready
+        prepareAuth();
+    }
+
+    void Display::startPreparedAuth(const QString &user, const Session &session) {
+        if (m_auth->isActive())
+            return;
+
+        if (!checkSession(session))
+            return;
+
+        // only spawn the helper and run PAM up to the first prompt, the
+        // session is looked up and set up once the login comes in
+        m_passPhrase.clear();
+        takeSpareAuth();
+
+        m_auth->setUser(user);
+        m_auth->setSession(session.exec());
+        m_auth->start();
+
+        prepareAuth();
+    }
+
+    Auth *Display::createAuth() {
+        Auth *auth = new Auth(this);
+        auth->setVerbose(true);
+        connect(auth, &Auth::requestChanged, this, &Display::slotRequestChanged);
+        connect(auth, &Auth::authentication, this, &Display::slotAuthenticationFinished);
+        connect(auth, &Auth::sessionStarted, this, &Display::slotSessionStarted);
+        connect(auth, &Auth::finished, this, &Display::slotHelperFinished);
+        connect(auth, &Auth::info, this, &Display::slotAuthInfo);
+        connect(auth, &Auth::error, this, &Display::slotAuthError);
+        connect(auth, &Auth::accounting, daemonApp->accounting(), &Accounting::append);
+        return auth;
+    }
+
+    void Display::prepareAuth() {
+        if (m_spareAuth || !mainConfig.PrepareHelper.get())
+            return;
+
+        m_spareAuth = createAuth();
+        m_spareAuth->prepare();
     }
 
     void Display::slotAuthenticationFinished(const QString &user, bool success) {
+        if (m_preparing) {
+            // PAM let the user in without asking, that still
+            // has to wait for the greeter to ask for the login
+            if (success) {
+                qCDebug(lcDisplay) << "No password needed for" << user << ", dropping the prepared login";
+                cancelPreparedLogin();
+            } else {
+                qCDebug(lcDisplay) << "Prepared login for" << user << "failed";
+                m_preparing = false;
+            }
+            return;
+        }
+
+        if (m_authTimer.isValid()) {
+            daemonApp->metrics()->observe(Metrics::AuthSeconds, seat()->name(), m_authTimer.elapsed());
+            m_authTimer.invalidate();
+        }
+        daemonApp->metrics()->count(success ? Metrics::LoginSuccesses : Metrics::LoginFailures, seat()->name());
+
         if (success) {
-            qDebug() << "Authenticated successfully";
+            qCDebug(lcDisplay) << "Authenticated successfully";
 
             if (!m_reuseSessionId.isNull()) {
                 OrgFreedesktopLogin1ManagerInterface manager(Logind::serviceName(), Logind::managerPath(), QDBusConnection::systemBus());
@@ -399,7 +664,7 @@ namespace SDDM {
             if (m_socket)
                 emit loginSucceeded(m_socket);
         } else if (m_socket) {
-            qDebug() << "Authentication failure";
+            qCDebug(lcDisplay) << "Authentication failure";
             emit loginFailed(m_socket);
         }
         m_socket = nullptr;
@@ -408,12 +673,12 @@ namespace SDDM {
     void Display::slotAuthInfo(const QString &message, Auth::Info info) {
         // TODO: presentable to the user, eventually
         Q_UNUSED(info);
-        qWarning() << "Authentication information:" << message;
+        qCWarning(lcDisplay) << "Authentication information:" << message;
     }
 
     void Display::slotAuthError(const QString &message, Auth::Error error) {
         // TODO: handle more errors
-        qWarning() << "Authentication error:" << message;
+        qCWarning(lcDisplay) << "Authentication error:" << message;
 
         if (!m_socket)
             return;
@@ -423,6 +688,11 @@ namespace SDDM {
     }
 
     void Display::slotHelperFinished(Auth::HelperExitStatus status) {
+        daemonApp->metrics()->count(Metrics::HelperExits, QString::number(status));
+
+        // the user session is over
+        unregisterSession();
+
         // Don't restart greeter and display server unless sddm-helper exited
         // with an internal error or the user session finished successfully,
         // we want to avoid greeter from restarting when an authentication
@@ -432,7 +702,19 @@ namespace SDDM {
             stop();
     }
 
+    void Display::greeterStartup(const QList<QPair<QString, quint32>> &timings) {
+        // the greeter measures from its own start, put that
+        // on the timeline of the seat
+        qCDebug(lcDisplay) << "Greeter on" << seat()->name() << "finished starting" << m_startTimer.elapsed() << "ms after the display";
+        for (const auto &timing : timings)
+            qCDebug(lcDisplay) << "    " << qPrintable(timing.first) << timing.second << "ms";
+    }
+
     void Display::slotRequestChanged() {
+        // a prepared login waits here for the password
+        if (m_preparing)
+            return;
+
         if (m_auth->request()->prompts().length() == 1) {
             m_auth->request()->prompts()[0]->setResponse(qPrintable(m_passPhrase));
             m_auth->request()->done();
@@ -444,6 +726,22 @@ namespace SDDM {
     }
 
     void Display::slotSessionStarted(bool success) {
-        qDebug() << "Session started";
+        qCDebug(lcDisplay) << "Session started";
+
+        // let D-Bus clients know about it, removed again when the helper exits
+        if (success)
+            emit ready();
+        if (success && m_registeredSession.isEmpty() && !m_displayManagerSession.isEmpty()) {
+            m_registeredSession = m_displayManagerSession;
+            daemonApp->displayManager()->AddSession(m_registeredSession, seat()->name(), m_auth->user());
+        }
+    }
+
+    void Display::unregisterSession() {
+        if (m_registeredSession.isEmpty())
+            return;
+
+        daemonApp->displayManager()->RemoveSession(m_registeredSession);
+        m_registeredSession.clear();
     }
 }
@@ -24,6 +24,7 @@
 
 #include <QObject>
 #include <QDir>
+#include <QElapsedTimer>
 
 #include "Auth.h"
 #include "Session.h"
@@ -53,31 +54,56 @@ namespace SDDM {
 
         Seat *seat() const;
 
+        // the display stopped because its display server went away
+        bool failed() const;
+
     public slots:
         bool start();
         void stop();
+        // starts the greeter again on the running display server,
+        // false if it failed to start
+        bool restartGreeter();
 
         void login(QLocalSocket *socket,
                    const QString &user, const QString &password,
                    const Session &session);
+        void prepareLogin(QLocalSocket *socket,
+                          const QString &user, const Session &session);
         bool attemptAutologin(QString &autologinSession, QString &autologinUserSession);
         void displayServerStarted();
 
     signals:
         void stopped();
+        void greeterFailed();
+        // a greeter connected or a session started, the display is usable
+        void ready();
 
         void loginFailed(QLocalSocket *socket);
         void loginSucceeded(QLocalSocket *socket);
 
     private:
         QString findGreeterTheme() const;
+        bool hasAutologin() const;
+        bool startGreeter(bool prepare);
         bool findSessionEntry(const QDir &dir, const QString &name) const;
 
         void startAuth(const QString &user, const QString &password,
                        const Session &session);
+        void startPreparedAuth(const QString &user, const Session &session);
+        bool checkSession(const Session &session) const;
+        QString findReusableSession(const QString &user) const;
+        void setUpSession(const Session &session);
+        void takeSpareAuth();
+        Auth *createAuth();
+        void prepareAuth();
+        void cancelPreparedLogin();
+        void unregisterSession();
 
         bool m_relogin { true };
         bool m_started { false };
+        bool m_failed { false };
+        bool m_greeterPrepared { false };
+        bool m_preparing { false };
 
         int m_terminalId { 7 };
 
@@ -85,16 +111,29 @@ namespace SDDM {
 
         QString m_passPhrase;
         QString m_sessionName;
+        // name of the next session on the DisplayManager D-Bus object,
+        // and of the one registered there while it runs
+        QString m_displayManagerSession;
+        QString m_registeredSession;
         QString m_reuseSessionId;
+        QString m_preparedUser;
+        QString m_preparedSession;
 
         Auth *m_auth { nullptr };
+        Auth *m_spareAuth { nullptr };
         DisplayServer *m_displayServer { nullptr };
         Seat *m_seat { nullptr };
         SocketServer *m_socketServer { nullptr };
         QLocalSocket *m_socket { nullptr };
         Greeter *m_greeter { nullptr };
 
+        QElapsedTimer m_startTimer;
+        QElapsedTimer m_authTimer;
+
     private slots:
+        void displayServerStopped();
+        void slotGreeterFailed();
+        void greeterStartup(const QList<QPair<QString, quint32>> &timings);
         void slotRequestChanged();
         void slotAuthenticationFinished(const QString &user, bool success);
         void slotSessionStarted(bool success);
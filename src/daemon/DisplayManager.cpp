@@ -20,9 +20,12 @@
 #include "DisplayManager.h"
 
 #include "DaemonApp.h"
+#include "LogCategories.h"
+#include "Metrics.h"
 #include "SeatManager.h"
 
 #include "displaymanageradaptor.h"
+#include "metricsadaptor.h"
 #include "seatadaptor.h"
 #include "sessionadaptor.h"
 
@@ -35,6 +38,7 @@ namespace SDDM {
     DisplayManager::DisplayManager(QObject *parent) : QObject(parent) {
         // create adaptor
         new DisplayManagerAdaptor(this);
+        new MetricsAdaptor(this);
 
         // register object
         QDBusConnection connection = (daemonApp->testing()) ? QDBusConnection::sessionBus() : QDBusConnection::systemBus();
@@ -62,19 +66,26 @@ namespace SDDM {
     ObjectPathList DisplayManager::Sessions(DisplayManagerSeat *seat) const {
         ObjectPathList sessions;
 
-        for (DisplayManagerSession *session: m_sessions)
-            if (seat == nullptr || seat->Name() == session->Seat())
+        if (seat == nullptr) {
+            for (DisplayManagerSession *session: m_sessions)
                 sessions << ObjectPath(session->Path());
+        } else {
+            for (DisplayManagerSession *session: m_seatSessions.value(seat->Name()))
+                sessions << ObjectPath(session->Path());
+        }
 
         return sessions;
     }
 
     void DisplayManager::AddSeat(const QString &name) {
+        if (m_seats.contains(name))
+            return;
+
         // create seat object
         DisplayManagerSeat *seat = new DisplayManagerSeat(name, this);
 
         // add to the list
-        m_seats << seat;
+        m_seats.insert(name, seat);
 
         // emit signal
         emit SeatAdded(ObjectPath(seat->Path()));
@@ -82,29 +93,36 @@ namespace SDDM {
 
     void DisplayManager::RemoveSeat(const QString &name) {
         // find seat
-        for (DisplayManagerSeat *seat: m_seats) {
-            if (seat->Name() == name) {
-                // remove from list
-                m_seats.removeAll(seat);
+        DisplayManagerSeat *seat = m_seats.take(name);
+        if (!seat)
+            return;
 
-                // get object path
-                ObjectPath path = ObjectPath(seat->Path());
+        // get object path
+        ObjectPath path = ObjectPath(seat->Path());
 
-                // delete seat
-                seat->deleteLater();
+        // delete seat
+        seat->deleteLater();
 
-                // emit signal
-                emit SeatRemoved(path);
-            }
-        }
+        // emit signal
+        emit SeatRemoved(path);
+    }
+
+    void DisplayManager::SeatHealthChanged(const QString &name, const QString &health) {
+        DisplayManagerSeat *seat = m_seats.value(name);
+        if (seat)
+            emit seat->HealthChanged(health);
     }
 
     void DisplayManager::AddSession(const QString &name, const QString &seat, const QString &user) {
+        if (m_sessions.contains(name))
+            return;
+
         // create session object
         DisplayManagerSession *session = new DisplayManagerSession(name, seat, user, this);
 
         // add to the list
-        m_sessions << session;
+        m_sessions.insert(name, session);
+        m_seatSessions[seat].insert(name, session);
 
         // emit signal
         emit SessionAdded(ObjectPath(session->Path()));
@@ -112,21 +130,39 @@ namespace SDDM {
 
     void DisplayManager::RemoveSession(const QString &name) {
         // find session
-        for (DisplayManagerSession *session: m_sessions) {
-            if (session->Name() == name) {
-                // remove from list
-                m_sessions.removeAll(session);
+        DisplayManagerSession *session = m_sessions.take(name);
+        if (!session)
+            return;
+
+        // remove from the seat
+        auto it = m_seatSessions.find(session->Seat());
+        if (it != m_seatSessions.end()) {
+            it->remove(name);
+            if (it->isEmpty())
+                m_seatSessions.erase(it);
+        }
 
-                // get object path
-                ObjectPath path = ObjectPath(session->Path());
+        // get object path
+        ObjectPath path = ObjectPath(session->Path());
 
-                // delete session
-                session->deleteLater();
+        // delete session
+        session->deleteLater();
 
-                // emit signal
-                emit SessionRemoved(path);
-            }
-        }
+        // emit signal
+        emit SessionRemoved(path);
+    }
+
+    void DisplayManager::SetLogRules(const QStringList &rules) {
+        qDebug() << "Setting log rules:" << rules;
+        setLogRules(rules);
+    }
+
+    QVariantMap DisplayManager::GetValues() const {
+        return daemonApp->metrics()->values();
+    }
+
+    QString DisplayManager::GetExposition() const {
+        return daemonApp->metrics()->exposition();
     }
 
     DisplayManagerSeat::DisplayManagerSeat(const QString &name, QObject *parent)
@@ -168,6 +204,14 @@ namespace SDDM {
        return daemonApp->displayManager()->Sessions(this);
     }
 
+    QString DisplayManagerSeat::Health() const {
+        return daemonApp->seatManager()->health(m_name);
+    }
+
+    uint DisplayManagerSeat::Restarts() const {
+        return daemonApp->seatManager()->restarts(m_name);
+    }
+
     DisplayManagerSession::DisplayManagerSession(const QString &name, const QString &seat, const QString &user, QObject *parent)
         : QObject(parent), m_name(name), m_path(DISPLAYMANAGER_SESSION_PATH + name.mid(7)), m_seat(seat), m_user(user) {
         // create adaptor
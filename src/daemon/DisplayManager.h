@@ -23,7 +23,10 @@
 #include <QObject>
 
 #include <QDBusObjectPath>
+#include <QHash>
 #include <QList>
+#include <QStringList>
+#include <QVariantMap>
 
 namespace SDDM {
     class DisplayManagerSeat;
@@ -54,6 +57,12 @@ namespace SDDM {
         void RemoveSeat(const QString &name);
         void AddSession(const QString &name, const QString &seat, const QString &user);
         void RemoveSession(const QString &name);
+        void SetLogRules(const QStringList &rules);
+        void SeatHealthChanged(const QString &name, const QString &health);
+
+        // org.freedesktop.DisplayManager.Metrics
+        QVariantMap GetValues() const;
+        QString GetExposition() const;
 
     signals:
         void SeatAdded(ObjectPath seat);
@@ -62,8 +71,10 @@ namespace SDDM {
         void SessionRemoved(ObjectPath session);
 
     private:
-        QList<DisplayManagerSeat *> m_seats;
-        QList<DisplayManagerSession *> m_sessions;
+        QHash<QString, DisplayManagerSeat *> m_seats;
+        QHash<QString, DisplayManagerSession *> m_sessions;
+        // sessions by seat name, then by session name
+        QHash<QString, QHash<QString, DisplayManagerSession *>> m_seatSessions;
     };
 
     /***************************************************************************
@@ -75,6 +86,8 @@ namespace SDDM {
         Q_PROPERTY(bool CanSwitch READ CanSwitch CONSTANT)
         Q_PROPERTY(bool HasGuestAccount READ HasGuestAccount CONSTANT)
         Q_PROPERTY(QList<QDBusObjectPath> Sessions READ Sessions CONSTANT)
+        Q_PROPERTY(QString Health READ Health)
+        Q_PROPERTY(uint Restarts READ Restarts)
     public:
         DisplayManagerSeat(const QString &name, QObject *parent = 0);
 
@@ -89,6 +102,11 @@ namespace SDDM {
         bool CanSwitch() { return true; }
         bool HasGuestAccount() { return false; }
         ObjectPathList Sessions();
+        QString Health() const;
+        uint Restarts() const;
+
+    signals:
+        void HealthChanged(const QString &health);
 
     private:
         QString m_name;
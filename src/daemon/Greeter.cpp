@@ -23,14 +23,20 @@
 #include "Constants.h"
 #include "DaemonApp.h"
 #include "DisplayManager.h"
+#include "LogCategories.h"
+#include "Metrics.h"
 #include "Seat.h"
 #include "ThemeConfig.h"
 #include "ThemeMetadata.h"
 #include "Display.h"
 
 #include <QtCore/QDebug>
+#include <QtCore/QDir>
 #include <QtCore/QProcess>
 
+#include <pwd.h>
+#include <unistd.h>
+
 namespace SDDM {
     Greeter::Greeter(QObject *parent) : QObject(parent) {
         m_metadata = new ThemeMetadata(QString());
@@ -71,11 +77,17 @@ namespace SDDM {
         }
     }
 
+    void Greeter::setPrepare(bool prepare) {
+        m_prepare = prepare;
+    }
+
     bool Greeter::start() {
         // check flag
         if (m_started)
             return false;
 
+        m_stopping = false;
+
         // themes
         QString xcursorTheme = mainConfig.Theme.CursorTheme.get();
         if (m_themeConfig->contains(QLatin1String("cursorTheme")))
@@ -97,6 +109,8 @@ namespace SDDM {
             args << QLatin1String("-platformtheme") << platformTheme;
         if (!style.isEmpty())
             args << QLatin1String("-style") << style;
+        if (m_prepare)
+            args << QLatin1String("--prepare");
 
         if (daemonApp->testing()) {
             // create process
@@ -109,10 +123,10 @@ namespace SDDM {
             connect(m_process, &QProcess::readyReadStandardError, this, &Greeter::onReadyReadStandardError);
 
             // log message
-            qDebug() << "Greeter starting...";
+            qCDebug(lcDisplay) << "Greeter starting...";
 
             // set process environment
-            QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+            QProcessEnvironment env = m_display->seat()->systemEnvironment();
             env.insert(QStringLiteral("DISPLAY"), m_display->name());
             env.insert(QStringLiteral("XAUTHORITY"), m_authPath);
             env.insert(QStringLiteral("XCURSOR_THEME"), xcursorTheme);
@@ -126,20 +140,20 @@ namespace SDDM {
 
             //if we fail to start bail immediately, and don't block in waitForStarted
             if (m_process->state() == QProcess::NotRunning) {
-                qCritical() << "Greeter failed to launch.";
+                qCCritical(lcDisplay) << "Greeter failed to launch.";
                 return false;
             }
             // wait for greeter to start
             if (!m_process->waitForStarted()) {
                 // log message
-                qCritical() << "Failed to start greeter.";
+                qCCritical(lcDisplay) << "Failed to start greeter.";
 
                 // return fail
                 return false;
             }
 
             // log message
-            qDebug() << "Greeter started.";
+            qCDebug(lcDisplay) << "Greeter started.";
 
             // set flag
             m_started = true;
@@ -158,40 +172,26 @@ namespace SDDM {
             cmd << QStringLiteral("%1/sddm-greeter").arg(QStringLiteral(BIN_INSTALL_DIR))
                 << args;
 
-            // greeter environment
-            QProcessEnvironment env;
-            QProcessEnvironment sysenv = QProcessEnvironment::systemEnvironment();
-
-            insertEnvironmentList({QStringLiteral("LANG"), QStringLiteral("LANGUAGE"),
-                                   QStringLiteral("LC_CTYPE"), QStringLiteral("LC_NUMERIC"), QStringLiteral("LC_TIME"), QStringLiteral("LC_COLLATE"),
-                                   QStringLiteral("LC_MONETARY"), QStringLiteral("LC_MESSAGES"), QStringLiteral("LC_PAPER"), QStringLiteral("LC_NAME"),
-                                   QStringLiteral("LC_ADDRESS"), QStringLiteral("LC_TELEPHONE"), QStringLiteral("LC_MEASUREMENT"), QStringLiteral("LC_IDENTIFICATION"),
-                                   QStringLiteral("LD_LIBRARY_PATH"),
-                                   QStringLiteral("QML2_IMPORT_PATH"),
-                                   QStringLiteral("QT_PLUGIN_PATH"),
-                                   QStringLiteral("XDG_DATA_DIRS")
-            }, sysenv, env);
-
-            env.insert(QStringLiteral("PATH"), mainConfig.Users.DefaultPath.get());
+            // greeter environment, starting from what the seat has precomputed
+            QProcessEnvironment env = m_display->seat()->greeterEnvironment();
             env.insert(QStringLiteral("DISPLAY"), m_display->name());
             env.insert(QStringLiteral("XAUTHORITY"), m_authPath);
             env.insert(QStringLiteral("XCURSOR_THEME"), xcursorTheme);
-            env.insert(QStringLiteral("XDG_SEAT"), m_display->seat()->name());
-            env.insert(QStringLiteral("XDG_SEAT_PATH"), daemonApp->displayManager()->seatPath(m_display->seat()->name()));
             env.insert(QStringLiteral("XDG_SESSION_PATH"), daemonApp->displayManager()->sessionPath(QStringLiteral("Session%1").arg(daemonApp->newSessionId())));
             if (m_display->seat()->name() == QLatin1String("seat0"))
                 env.insert(QStringLiteral("XDG_VTNR"), QString::number(m_display->terminalId()));
-            env.insert(QStringLiteral("XDG_SESSION_CLASS"), QStringLiteral("greeter"));
             env.insert(QStringLiteral("XDG_SESSION_TYPE"), m_display->sessionType());
-            env.insert(QStringLiteral("QT_IM_MODULE"), mainConfig.InputMethod.get());
 
-            //some themes may use KDE components and that will automatically load KDE's crash handler which we don't want
-            //counterintuitively setting this env disables that handler
-            env.insert(QStringLiteral("KDE_DEBUG"), QStringLiteral("1"));
+            // keep the compiled QML of themes in a persistent location
+            // owned by the sddm user, which has no writable home
+            const QString cacheDir = mainConfig.Theme.CacheDir.get();
+            if (!cacheDir.isEmpty() && prepareCacheDir(cacheDir))
+                env.insert(QStringLiteral("XDG_CACHE_HOME"), cacheDir);
+
             m_auth->insertEnvironment(env);
 
             // log message
-            qDebug() << "Greeter starting...";
+            qCDebug(lcDisplay) << "Greeter starting...";
 
             // start greeter
             m_auth->setUser(QStringLiteral("sddm"));
@@ -204,10 +204,20 @@ namespace SDDM {
         return true;
     }
 
-    void Greeter::insertEnvironmentList(QStringList names, QProcessEnvironment sourceEnv, QProcessEnvironment &targetEnv) {
-        for (QStringList::const_iterator it = names.constBegin(); it != names.constEnd(); ++it)
-            if (sourceEnv.contains(*it))
-                targetEnv.insert(*it, sourceEnv.value(*it));
+    bool Greeter::prepareCacheDir(const QString &path) {
+        if (!QDir().mkpath(path)) {
+            qCWarning(lcDisplay) << "Failed to create greeter cache directory" << path;
+            return false;
+        }
+
+        // change the owner and group of the directory to the sddm user
+        struct passwd *pw = getpwnam("sddm");
+        if (pw && chown(qPrintable(path), pw->pw_uid, pw->pw_gid) == -1) {
+            qCWarning(lcDisplay) << "Failed to change owner of the greeter cache directory";
+            return false;
+        }
+
+        return true;
     }
 
     void Greeter::stop() {
@@ -216,13 +226,16 @@ namespace SDDM {
             return;
 
         // log message
-        qDebug() << "Greeter stopping...";
+        qCDebug(lcDisplay) << "Greeter stopping...";
+
+        m_stopping = true;
 
         if (daemonApp->testing()) {
             // terminate process
             m_process->terminate();
 
             // wait for finished
+            BlockingCall blocking("greeter-stop");
             if (!m_process->waitForFinished(5000))
                 m_process->kill();
         }
@@ -237,11 +250,19 @@ namespace SDDM {
         m_started = false;
 
         // log message
-        qDebug() << "Greeter stopped.";
+        qCDebug(lcDisplay) << "Greeter stopped.";
+
+        bool crashed = !m_stopping &&
+                (m_process->exitStatus() == QProcess::CrashExit || m_process->exitCode() != 0);
 
         // clean up
         m_process->deleteLater();
         m_process = nullptr;
+
+        if (crashed) {
+            daemonApp->metrics()->count(Metrics::GreeterCrashes, m_display->seat()->name());
+            emit failed();
+        }
     }
 
     void Greeter::onRequestChanged() {
@@ -254,9 +275,9 @@ namespace SDDM {
 
         // log message
         if (success)
-            qDebug() << "Greeter session started successfully";
+            qCDebug(lcDisplay) << "Greeter session started successfully";
         else
-            qDebug() << "Greeter session failed to start";
+            qCDebug(lcDisplay) << "Greeter session failed to start";
     }
 
     void Greeter::onHelperFinished(Auth::HelperExitStatus status) {
@@ -264,34 +285,39 @@ namespace SDDM {
         m_started = false;
 
         // log message
-        qDebug() << "Greeter stopped.";
+        qCDebug(lcDisplay) << "Greeter stopped.";
 
         // clean up
         m_auth->deleteLater();
         m_auth = nullptr;
+
+        if (status != Auth::HELPER_SUCCESS && !m_stopping) {
+            daemonApp->metrics()->count(Metrics::GreeterCrashes, m_display->seat()->name());
+            emit failed();
+        }
     }
 
     void Greeter::onReadyReadStandardError()
     {
         if (m_process) {
-            qDebug() << "Greeter errors:" << qPrintable(QString::fromLocal8Bit(m_process->readAllStandardError()));
+            qCDebug(lcDisplay) << "Greeter errors:" << qPrintable(QString::fromLocal8Bit(m_process->readAllStandardError()));
         }
     }
 
     void Greeter::onReadyReadStandardOutput()
     {
         if (m_process) {
-            qDebug() << "Greeter output:" << qPrintable(QString::fromLocal8Bit(m_process->readAllStandardOutput()));
+            qCDebug(lcDisplay) << "Greeter output:" << qPrintable(QString::fromLocal8Bit(m_process->readAllStandardOutput()));
         }
     }
 
     void Greeter::authInfo(const QString &message, Auth::Info info) {
         Q_UNUSED(info);
-        qDebug() << "Information from greeter session:" << message;
+        qCDebug(lcDisplay) << "Information from greeter session:" << message;
     }
 
     void Greeter::authError(const QString &message, Auth::Error error) {
         Q_UNUSED(error);
-        qWarning() << "Error from greeter session:" << message;
+        qCWarning(lcDisplay) << "Error from greeter session:" << message;
     }
 }
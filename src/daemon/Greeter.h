@@ -42,12 +42,17 @@ namespace SDDM {
         void setAuthPath(const QString &authPath);
         void setSocket(const QString &socket);
         void setTheme(const QString &theme);
+        void setPrepare(bool prepare);
 
     public slots:
         bool start();
         void stop();
         void finished();
 
+    signals:
+        // the greeter exited with an error without being asked to stop
+        void failed();
+
     private slots:
         void onRequestChanged();
         void onSessionStarted(bool success);
@@ -59,6 +64,8 @@ namespace SDDM {
 
     private:
         bool m_started { false };
+        bool m_prepare { false };
+        bool m_stopping { false };
 
         Display *m_display { nullptr };
         QString m_authPath;
@@ -70,7 +77,7 @@ namespace SDDM {
         Auth *m_auth { nullptr };
         QProcess *m_process { nullptr };
 
-        static void insertEnvironmentList(QStringList names, QProcessEnvironment sourceEnv, QProcessEnvironment &targetEnv);
+        static bool prepareCacheDir(const QString &path);
     };
 }
 
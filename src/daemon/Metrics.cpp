@@ -0,0 +1,190 @@
+/***************************************************************************
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+
+#include "Metrics.h"
+
+#include "Configuration.h"
+#include "DaemonApp.h"
+#include "LogCategories.h"
+
+#include <QSaveFile>
+#include <QTimer>
+
+namespace SDDM {
+    struct MetricInfo {
+        const char *name;
+        const char *label;
+        const char *help;
+    };
+
+    static const MetricInfo counterInfo[Metrics::_COUNTER_LAST] = {
+        { "sddm_display_starts_total",          "seat", "Displays started" },
+        { "sddm_display_restarts_total",        "seat", "Displays started again after the previous one stopped" },
+        { "sddm_greeter_crashes_total",         "seat", "Greeters that exited with an error" },
+        { "sddm_greeter_restarts_total",        "seat", "Greeters started again on a running display after they failed" },
+        { "sddm_login_attempts_total",          "seat", "Logins submitted, including autologin" },
+        { "sddm_login_successes_total",         "seat", "Logins that authenticated successfully" },
+        { "sddm_login_failures_total",          "seat", "Logins that failed to authenticate" },
+        { "sddm_helper_exits_total",            "code", "sddm-helper exits by exit code" },
+        { "sddm_blocked_seconds_total",         "call", "Time the daemon spent blocked in synchronous calls" },
+        { "sddm_blocked_calls_total",           "call", "Synchronous calls the daemon blocked in" },
+    };
+
+    static const MetricInfo histogramInfo[Metrics::_HISTOGRAM_LAST] = {
+        { "sddm_xorg_start_duration_seconds",   "seat", "Time from starting the X server until it accepts connections" },
+        { "sddm_auth_duration_seconds",         "seat", "Time from submitting a login until the authentication result" },
+    };
+
+    // upper bounds in seconds, the last bucket is +Inf
+    static const double bucketBounds[] = { 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30 };
+    static const int bucketCount = sizeof(bucketBounds) / sizeof(bucketBounds[0]);
+
+    static QString series(const char *name, const char *label, const QString &value, const QString &extra = QString()) {
+        QString escaped = value;
+        escaped.replace(QLatin1Char('\\'), QLatin1String("\\\\")).replace(QLatin1Char('"'), QLatin1String("\\\""));
+        return QStringLiteral("%1{%2=\"%3\"%4}").arg(QLatin1String(name)).arg(QLatin1String(label)).arg(escaped).arg(extra);
+    }
+
+    // all significant digits, arg(double) would round counters above
+    // 999999 to six of them
+    static QString number(double value) {
+        return QString::number(value, 'g', 17);
+    }
+
+    Metrics::Metrics(QObject *parent) : QObject(parent) {
+        if (mainConfig.MetricsFile.get().isEmpty())
+            return;
+
+        m_timer = new QTimer(this);
+        m_timer->setInterval(qMax(1, mainConfig.MetricsInterval.get()) * 1000);
+        connect(m_timer, &QTimer::timeout, this, &Metrics::writeFile);
+        m_timer->start();
+    }
+
+    Metrics::~Metrics() {
+        if (m_timer)
+            writeFile();
+    }
+
+    void Metrics::count(Counter counter, const QString &label, double value) {
+        m_counters[counter][label] += value;
+    }
+
+    void Metrics::observe(Histogram histogram, const QString &seat, qint64 msecs) {
+        Buckets &buckets = m_histograms[histogram][seat];
+        if (buckets.counts.isEmpty())
+            buckets.counts.fill(0, bucketCount);
+
+        const double seconds = msecs / 1000.0;
+        for (int i = 0; i < bucketCount; ++i) {
+            if (seconds <= bucketBounds[i])
+                buckets.counts[i]++;
+        }
+        buckets.count++;
+        buckets.sum += seconds;
+    }
+
+    QVariantMap Metrics::values() const {
+        QVariantMap map;
+
+        for (int c = 0; c < _COUNTER_LAST; ++c) {
+            const MetricInfo &info = counterInfo[c];
+            for (auto it = m_counters[c].constBegin(); it != m_counters[c].constEnd(); ++it)
+                map.insert(series(info.name, info.label, it.key()), it.value());
+        }
+
+        for (int h = 0; h < _HISTOGRAM_LAST; ++h) {
+            const MetricInfo &info = histogramInfo[h];
+            const QString name = QLatin1String(info.name);
+            for (auto it = m_histograms[h].constBegin(); it != m_histograms[h].constEnd(); ++it) {
+                map.insert(series(qPrintable(name + QStringLiteral("_sum")), info.label, it.key()), it.value().sum);
+                map.insert(series(qPrintable(name + QStringLiteral("_count")), info.label, it.key()), double(it.value().count));
+            }
+        }
+
+        return map;
+    }
+
+    QString Metrics::exposition() const {
+        QString text;
+
+        for (int c = 0; c < _COUNTER_LAST; ++c) {
+            const MetricInfo &info = counterInfo[c];
+            text += QStringLiteral("# HELP %1 %2\n# TYPE %1 counter\n").arg(QLatin1String(info.name)).arg(QLatin1String(info.help));
+
+            QStringList labels = m_counters[c].keys();
+            labels.sort();
+            for (const QString &label : qAsConst(labels))
+                text += QStringLiteral("%1 %2\n").arg(series(info.name, info.label, label)).arg(number(m_counters[c].value(label)));
+        }
+
+        for (int h = 0; h < _HISTOGRAM_LAST; ++h) {
+            const MetricInfo &info = histogramInfo[h];
+            const QString name = QLatin1String(info.name);
+            text += QStringLiteral("# HELP %1 %2\n# TYPE %1 histogram\n").arg(name).arg(QLatin1String(info.help));
+
+            QStringList labels = m_histograms[h].keys();
+            labels.sort();
+            for (const QString &label : qAsConst(labels)) {
+                const Buckets &buckets = m_histograms[h][label];
+                const QByteArray bucketName = (name + QStringLiteral("_bucket")).toLatin1();
+                for (int i = 0; i < bucketCount; ++i) {
+                    text += QStringLiteral("%1 %2\n")
+                            .arg(series(bucketName.constData(), info.label, label, QStringLiteral(",le=\"%1\"").arg(bucketBounds[i])))
+                            .arg(buckets.counts[i]);
+                }
+                text += QStringLiteral("%1 %2\n").arg(series(bucketName.constData(), info.label, label, QStringLiteral(",le=\"+Inf\""))).arg(buckets.count);
+                text += QStringLiteral("%1 %2\n").arg(series(qPrintable(name + QStringLiteral("_sum")), info.label, label)).arg(number(buckets.sum));
+                text += QStringLiteral("%1 %2\n").arg(series(qPrintable(name + QStringLiteral("_count")), info.label, label)).arg(buckets.count);
+            }
+        }
+
+        return text;
+    }
+
+    void Metrics::writeFile() {
+        const QString path = mainConfig.MetricsFile.get();
+        if (path.isEmpty())
+            return;
+
+        // replaced atomically, scrapers never see a partial file
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly)) {
+            qCWarning(lcSeat) << "Failed to write metrics to" << path << ":" << file.errorString();
+            return;
+        }
+        file.write(exposition().toUtf8());
+        if (!file.commit())
+            qCWarning(lcSeat) << "Failed to write metrics to" << path << ":" << file.errorString();
+    }
+
+    BlockingCall::BlockingCall(const char *call) : m_call(call) {
+        m_timer.start();
+    }
+
+    BlockingCall::~BlockingCall() {
+        Metrics *metrics = daemonApp->metrics();
+        if (!metrics)
+            return;
+
+        const QString call = QLatin1String(m_call);
+        metrics->count(Metrics::BlockedSeconds, call, m_timer.elapsed() / 1000.0);
+        metrics->count(Metrics::BlockedCalls, call);
+    }
+}
@@ -0,0 +1,119 @@
+/***************************************************************************
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+
+#ifndef SDDM_METRICS_H
+#define SDDM_METRICS_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QVariantMap>
+#include <QVector>
+
+class QTimer;
+
+namespace SDDM {
+    /**
+     * Operational counters of the daemon.
+     *
+     * Exported on the org.freedesktop.DisplayManager.Metrics D-Bus
+     * interface and, when General.MetricsFile is set, written there
+     * periodically in the Prometheus text exposition format.
+     */
+    class Metrics : public QObject {
+        Q_OBJECT
+        Q_DISABLE_COPY(Metrics)
+    public:
+        enum Counter {
+            DisplayStarts,
+            DisplayRestarts,
+            GreeterCrashes,
+            GreeterRestarts,
+            LoginAttempts,
+            LoginSuccesses,
+            LoginFailures,
+            HelperExits,
+            BlockedSeconds,
+            BlockedCalls,
+            _COUNTER_LAST
+        };
+
+        enum Histogram {
+            XorgStartSeconds,
+            AuthSeconds,
+            _HISTOGRAM_LAST
+        };
+
+        explicit Metrics(QObject *parent = 0);
+        ~Metrics();
+
+        /**
+         * Adds \p value to a counter. The label is the seat, except for
+         * HelperExits (the exit code) and the blocked calls (the call).
+         */
+        void count(Counter counter, const QString &label, double value = 1);
+
+        /**
+         * Records a duration in a histogram, labelled with the seat.
+         */
+        void observe(Histogram histogram, const QString &seat, qint64 msecs);
+
+        /**
+         * All current values, keyed by series as in the exposition.
+         */
+        QVariantMap values() const;
+
+        /**
+         * All current values in the Prometheus text exposition format.
+         */
+        QString exposition() const;
+
+    public slots:
+        void writeFile();
+
+    private:
+        struct Buckets {
+            QVector<quint64> counts;
+            quint64 count { 0 };
+            double sum { 0 };
+        };
+
+        QHash<QString, double> m_counters[_COUNTER_LAST];
+        QHash<QString, Buckets> m_histograms[_HISTOGRAM_LAST];
+        QTimer *m_timer { nullptr };
+    };
+
+    /**
+     * Adds the time until it goes out of scope to the time spent blocked
+     * in synchronous calls, labelled with \p call.
+     */
+    class BlockingCall {
+    public:
+        explicit BlockingCall(const char *call);
+        ~BlockingCall();
+
+    private:
+        Q_DISABLE_COPY(BlockingCall)
+
+        const char *m_call { nullptr };
+        QElapsedTimer m_timer;
+    };
+}
+
+#endif // SDDM_METRICS_H
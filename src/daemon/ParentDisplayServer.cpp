@@ -0,0 +1,249 @@
+/***************************************************************************
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+
+#include "ParentDisplayServer.h"
+
+#include "Configuration.h"
+#include "Constants.h"
+#include "DaemonApp.h"
+#include "LogCategories.h"
+#include "Metrics.h"
+#include "VirtualTerminal.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QProcess>
+#include <QSocketNotifier>
+#include <QUuid>
+
+#include <random>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace SDDM {
+    ParentDisplayServer::ParentDisplayServer(QObject *parent) : DisplayServer(nullptr) {
+        setParent(parent);
+
+        QDir().mkpath(QStringLiteral(RUNTIME_DIR));
+        m_authPath = QStringLiteral("%1/%2").arg(QStringLiteral(RUNTIME_DIR)).arg(QUuid::createUuid().toString());
+
+        // generate cookie
+        std::random_device rd;
+        std::mt19937 gen(rd());
+        std::uniform_int_distribution<> dis(0, 15);
+
+        const char *digits = "0123456789abcdef";
+        for (int i = 0; i < 32; ++i)
+            m_cookie.append(QLatin1Char(digits[dis(gen)]));
+    }
+
+    ParentDisplayServer::~ParentDisplayServer() {
+        stop();
+    }
+
+    const QString &ParentDisplayServer::authPath() const {
+        return m_authPath;
+    }
+
+    QString ParentDisplayServer::sessionType() const {
+        return QStringLiteral("x11");
+    }
+
+    bool ParentDisplayServer::isReady() const {
+        return m_started;
+    }
+
+    void ParentDisplayServer::addToEnvironment(QProcessEnvironment &env) const {
+        env.insert(QStringLiteral("DISPLAY"), m_display);
+        env.insert(QStringLiteral("XAUTHORITY"), m_authPath);
+    }
+
+    bool ParentDisplayServer::addCookie() {
+        QFile file(m_authPath);
+        file.open(QIODevice::Append);
+        file.close();
+
+        QString cmd = QStringLiteral("%1 -f %2 -q").arg(mainConfig.X11.XauthPath.get()).arg(m_authPath);
+
+        FILE *fp = popen(qPrintable(cmd), "w");
+        if (!fp)
+            return false;
+        fprintf(fp, "remove %s\n", qPrintable(m_display));
+        fprintf(fp, "add %s . %s\n", qPrintable(m_display), qPrintable(m_cookie));
+        fprintf(fp, "exit\n");
+
+        return pclose(fp) == 0;
+    }
+
+    bool ParentDisplayServer::start() {
+        // already running or starting
+        if (m_process)
+            return false;
+
+        qCDebug(lcXorg) << "Parent display server starting...";
+        m_startTimer.start();
+
+        // the display number doesn't matter for the server's copy,
+        // the real entry is added once the server told us its number
+        m_display = QStringLiteral(":0");
+        if (!addCookie()) {
+            qCCritical(lcXorg) << "Failed to write xauth file of the parent display server";
+            return false;
+        }
+
+        m_terminalId = VirtualTerminal::allocateVt(mainConfig.X11.MinimumVT.get());
+        if (m_terminalId < 0) {
+            qCCritical(lcXorg) << "No free VT for the parent display server";
+            return false;
+        }
+
+        int pipeFds[2];
+        if (pipe(pipeFds) != 0) {
+            qCCritical(lcXorg) << "Could not create pipe to start the parent display server";
+            VirtualTerminal::releaseVt(m_terminalId);
+            m_terminalId = -1;
+            return false;
+        }
+        fcntl(pipeFds[0], F_SETFD, FD_CLOEXEC);
+
+        m_process = new QProcess(this);
+        connect(m_process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, &ParentDisplayServer::finished);
+        connect(m_process, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+            if (error == QProcess::FailedToStart) {
+                qCCritical(lcXorg) << "Failed to start the parent display server process.";
+                finished();
+            }
+        });
+
+        QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+        env.insert(QStringLiteral("XCURSOR_THEME"), mainConfig.Theme.CursorTheme.get());
+        m_process->setProcessEnvironment(env);
+
+        QStringList args;
+        args << mainConfig.X11.ServerArguments.get().split(QLatin1Char(' '), QString::SkipEmptyParts)
+             << QStringLiteral("-background") << QStringLiteral("none")
+             << QStringLiteral("-seat") << QStringLiteral("seat0")
+             << QStringLiteral("-noreset")
+             << QStringLiteral("-displayfd") << QString::number(pipeFds[1])
+             << QStringLiteral("vt%1").arg(m_terminalId)
+             << QStringLiteral("-auth") << m_authPath;
+
+        m_process->setProgram(mainConfig.X11.ServerPath.get());
+        m_process->setArguments(args);
+        qCDebug(lcXorg) << "Running:"
+            << qPrintable(m_process->program())
+            << qPrintable(m_process->arguments().join(QLatin1Char(' ')));
+        m_process->start();
+
+        // only the server keeps the writing end, so a server that exits
+        // before it's ready shows up as end of file
+        close(pipeFds[1]);
+
+        m_readFd = pipeFds[0];
+        m_displayNumber.clear();
+        m_notifier = new QSocketNotifier(m_readFd, QSocketNotifier::Read, this);
+        connect(m_notifier, &QSocketNotifier::activated, this, &ParentDisplayServer::readDisplayNumber);
+
+        return true;
+    }
+
+    void ParentDisplayServer::readDisplayNumber() {
+        char buffer[16];
+        ssize_t length = read(m_readFd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            // the server is gone, finished() takes care of the rest
+            if (length < 0 && errno == EINTR)
+                return;
+            qCCritical(lcXorg) << "Parent display server exited before reporting its display number";
+            closePipe();
+            return;
+        }
+
+        m_displayNumber.append(buffer, length);
+        if (!m_displayNumber.contains('\n'))
+            return;
+
+        closePipe();
+
+        m_display = QStringLiteral(":") + QString::fromLocal8Bit(m_displayNumber.trimmed());
+        if (m_display != QStringLiteral(":0") && !addCookie()) {
+            qCCritical(lcXorg) << "Failed to write xauth file of the parent display server";
+            stop();
+            return;
+        }
+
+        qCDebug(lcXorg) << "Parent display server ready on" << m_display;
+        daemonApp->metrics()->observe(Metrics::XorgStartSeconds, QStringLiteral("seat0"), m_startTimer.elapsed());
+
+        m_started = true;
+        emit started();
+    }
+
+    void ParentDisplayServer::closePipe() {
+        if (m_notifier) {
+            m_notifier->setEnabled(false);
+            m_notifier->deleteLater();
+            m_notifier = nullptr;
+        }
+        if (m_readFd >= 0) {
+            close(m_readFd);
+            m_readFd = -1;
+        }
+    }
+
+    void ParentDisplayServer::stop() {
+        if (!m_process)
+            return;
+
+        qCDebug(lcXorg) << "Parent display server stopping...";
+
+        m_process->terminate();
+
+        BlockingCall blocking("xorg-stop");
+        if (!m_process->waitForFinished(5000))
+            m_process->kill();
+    }
+
+    void ParentDisplayServer::finished() {
+        if (!m_process)
+            return;
+
+        qCDebug(lcXorg) << "Parent display server stopped.";
+
+        closePipe();
+
+        m_process->deleteLater();
+        m_process = nullptr;
+
+        VirtualTerminal::releaseVt(m_terminalId);
+        m_terminalId = -1;
+
+        QFile::remove(m_authPath);
+
+        m_started = false;
+        emit stopped();
+    }
+
+    void ParentDisplayServer::setupDisplay() {
+        // nothing to do, the nested servers cover the whole screen
+    }
+}
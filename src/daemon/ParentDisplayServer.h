@@ -0,0 +1,80 @@
+/***************************************************************************
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+
+#ifndef SDDM_PARENTDISPLAYSERVER_H
+#define SDDM_PARENTDISPLAYSERVER_H
+
+#include "DisplayServer.h"
+
+#include <QElapsedTimer>
+
+class QProcess;
+class QProcessEnvironment;
+class QSocketNotifier;
+
+namespace SDDM {
+    /*!
+     \brief The X server on seat0 that hosts the nested seats
+
+     Started with -displayfd, started() is emitted as soon as the server
+     reports its display number, without blocking the event loop.
+    */
+    class ParentDisplayServer : public DisplayServer {
+        Q_OBJECT
+        Q_DISABLE_COPY(ParentDisplayServer)
+    public:
+        explicit ParentDisplayServer(QObject *parent = nullptr);
+        ~ParentDisplayServer();
+
+        const QString &authPath() const;
+
+        QString sessionType() const;
+
+        bool isReady() const;
+
+        // DISPLAY and XAUTHORITY for the clients of this server
+        void addToEnvironment(QProcessEnvironment &env) const;
+
+    public slots:
+        bool start();
+        void stop();
+        void finished();
+        void setupDisplay();
+
+    private slots:
+        void readDisplayNumber();
+
+    private:
+        bool addCookie();
+        void closePipe();
+
+        QString m_authPath;
+        QString m_cookie;
+        QByteArray m_displayNumber;
+        QElapsedTimer m_startTimer;
+
+        int m_terminalId { -1 };
+        int m_readFd { -1 };
+
+        QProcess *m_process { nullptr };
+        QSocketNotifier *m_notifier { nullptr };
+    };
+}
+
+#endif // SDDM_PARENTDISPLAYSERVER_H
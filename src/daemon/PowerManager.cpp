@@ -22,6 +22,7 @@
 #include "Configuration.h"
 #include "DaemonApp.h"
 #include "Messages.h"
+#include "Metrics.h"
 
 #include <QDBusConnectionInterface>
 #include <QDBusInterface>
@@ -217,6 +218,7 @@ const QString CK2_OBJECT = QStringLiteral("org.freedesktop.ConsoleKit.Manager");
     Capabilities PowerManager::capabilities() const {
         Capabilities caps = Capability::None;
 
+        BlockingCall blocking("power-capabilities");
         for (PowerManagerBackend *backend: m_backends)
             caps |= backend->capabilities();
 
@@ -23,28 +23,23 @@
 #include "Configuration.h"
 #include "DaemonApp.h"
 #include "Display.h"
+#include "DisplayManager.h"
+#include "LogCategories.h"
+#include "Metrics.h"
+#include "SeatSupervisor.h"
 #include "XorgDisplayServer.h"
 #include "VirtualTerminal.h"
+#include "VtSwitcher.h"
 
 #include <QDebug>
 #include <QFile>
 
-#include <functional>
-
 namespace SDDM {
-    int findUnused(int minimum, std::function<bool(const int)> used) {
-        // initialize with minimum
-        int number = minimum;
-
-        // find unused
-        while (used(number))
-            number++;
-
-        // return number;
-        return number;
-    }
+    Seat::Seat(const QString &name, QObject *parent) : QObject(parent), m_name(name),
+        m_systemEnvironment(QProcessEnvironment::systemEnvironment()),
+        m_supervisor(new SeatSupervisor(name, this)) {
+        connect(m_supervisor, &SeatSupervisor::healthChanged, this, &Seat::healthChanged);
 
-    Seat::Seat(const QString &name, QObject *parent) : QObject(parent), m_name(name) {
         createDisplay();
     }
 
@@ -52,26 +47,86 @@ namespace SDDM {
         return m_name;
     }
 
+    const QProcessEnvironment &Seat::systemEnvironment() const {
+        return m_systemEnvironment;
+    }
+
+    const QProcessEnvironment &Seat::greeterEnvironment() const {
+        return m_greeterEnvironment;
+    }
+
+    SeatSupervisor *Seat::supervisor() const {
+        return m_supervisor;
+    }
+
+    void Seat::updateGreeterEnvironment() {
+        QProcessEnvironment env;
+
+        // pass through what the greeter needs from our own environment
+        static const QStringList names {
+            QStringLiteral("LANG"), QStringLiteral("LANGUAGE"),
+            QStringLiteral("LC_CTYPE"), QStringLiteral("LC_NUMERIC"), QStringLiteral("LC_TIME"), QStringLiteral("LC_COLLATE"),
+            QStringLiteral("LC_MONETARY"), QStringLiteral("LC_MESSAGES"), QStringLiteral("LC_PAPER"), QStringLiteral("LC_NAME"),
+            QStringLiteral("LC_ADDRESS"), QStringLiteral("LC_TELEPHONE"), QStringLiteral("LC_MEASUREMENT"), QStringLiteral("LC_IDENTIFICATION"),
+            QStringLiteral("LD_LIBRARY_PATH"),
+            QStringLiteral("QML2_IMPORT_PATH"),
+            QStringLiteral("QT_PLUGIN_PATH"),
+            QStringLiteral("SDDM_STARTUP_TIMINGS"),
+            QStringLiteral("XDG_DATA_DIRS")
+        };
+        for (const QString &name : names) {
+            if (m_systemEnvironment.contains(name))
+                env.insert(name, m_systemEnvironment.value(name));
+        }
+
+        // the parts that are the same for every greeter on this seat
+        env.insert(QStringLiteral("PATH"), mainConfig.Users.DefaultPath.get());
+        env.insert(QStringLiteral("XDG_SEAT"), m_name);
+        env.insert(QStringLiteral("XDG_SEAT_PATH"), daemonApp->displayManager()->seatPath(m_name));
+        env.insert(QStringLiteral("XDG_SESSION_CLASS"), QStringLiteral("greeter"));
+        env.insert(QStringLiteral("QT_IM_MODULE"), mainConfig.InputMethod.get());
+
+        //some themes may use KDE components and that will automatically load KDE's crash handler which we don't want
+        //counterintuitively setting this env disables that handler
+        env.insert(QStringLiteral("KDE_DEBUG"), QStringLiteral("1"));
+
+        m_greeterEnvironment = env;
+    }
+
     bool Seat::createDisplay(int terminalId) {
         //reload config if needed
         mainConfig.load();
+        updateGreeterEnvironment();
+
+        return startDisplay(terminalId);
+    }
 
+    bool Seat::startDisplay(int terminalId) {
         if (m_name == QLatin1String("seat0")) {
             if (terminalId == -1) {
-                // find unused terminal
-                terminalId = findUnused(mainConfig.X11.MinimumVT.get(), [&](const int number) {
-                    return m_terminalIds.contains(number);
-                });
+                // find a terminal that is neither open nor reserved by a helper,
+                // so the X server doesn't fail on a VT someone else grabbed
+                terminalId = VirtualTerminal::allocateVt(mainConfig.X11.MinimumVT.get());
+                if (terminalId < 0) {
+                    qCCritical(lcSeat) << "No free VT for a new display";
+
+                    // one may be released later
+                    if (m_displays.isEmpty())
+                        m_supervisor->failed(SeatSupervisor::DisplayServerLayer, [this]() { restartDisplay(); });
+                    return false;
+                }
+            } else {
+                VirtualTerminal::reserveVt(terminalId);
             }
 
             // mark terminal as used
             m_terminalIds << terminalId;
 
             // log message
-            qDebug() << "Adding new display" << "on vt" << terminalId << "...";
+            qCDebug(lcSeat) << "Adding new display" << "on vt" << terminalId << "...";
         }
         else {
-            qDebug() << "Adding new VT-less display...";
+            qCDebug(lcSeat) << "Adding new VT-less display...";
         }
 
         // create a new display
@@ -79,28 +134,45 @@ namespace SDDM {
 
         // restart display on stop
         connect(display, &Display::stopped, this, &Seat::displayStopped);
+        connect(display, &Display::greeterFailed, this, &Seat::greeterFailed);
+        connect(display, &Display::ready, m_supervisor, &SeatSupervisor::started);
 
         // add display to the list
         m_displays << display;
 
         // start the display
         if (!display->start()) {
-            qCritical() << "Could not start Display server on vt" << terminalId;
+            qCCritical(lcSeat) << "Could not start Display server on vt" << terminalId;
+
+            // try again later instead of leaving the seat without a display
+            removeDisplay(display);
+            if (m_displays.isEmpty())
+                m_supervisor->failed(SeatSupervisor::DisplayServerLayer, [this]() { restartDisplay(); });
             return false;
         }
 
         return true;
     }
 
+    void Seat::restartDisplay() {
+        // only the display server and the greeter on it, the configuration
+        // and the environment are still the ones it was started with
+        if (m_displays.isEmpty()) {
+            daemonApp->metrics()->count(Metrics::DisplayRestarts, m_name);
+            startDisplay(-1);
+        }
+    }
+
     void Seat::removeDisplay(Display* display) {
-        qDebug() << "Removing display" << display->displayId() << "...";
+        qCDebug(lcSeat) << "Removing display" << display->displayId() << "...";
 
 
         // remove display from list
         m_displays.removeAll(display);
 
         // mark display and terminal ids as unused
-        m_terminalIds.removeAll(display->terminalId());
+        if (m_terminalIds.removeAll(display->terminalId()) > 0)
+            VirtualTerminal::releaseVt(display->terminalId());
 
         // stop the display
         display->blockSignals(true);
@@ -113,12 +185,16 @@ namespace SDDM {
 
     void Seat::displayStopped() {
         Display *display = qobject_cast<Display *>(sender());
+        bool failed = display->failed();
 
         // remove display
         removeDisplay(display);
 
-        // restart otherwise
-        if (m_displays.isEmpty()) {
+        // restart otherwise, a failed display server after a delay
+        if (m_displays.isEmpty() && failed) {
+            m_supervisor->failed(SeatSupervisor::DisplayServerLayer, [this]() { restartDisplay(); });
+        } else if (m_displays.isEmpty()) {
+            daemonApp->metrics()->count(Metrics::DisplayRestarts, m_name);
             createDisplay();
         }
         // If there is still a session running on some display,
@@ -128,7 +204,26 @@ namespace SDDM {
         else {
             int disp = m_displays.last()->terminalId();
             if (disp != -1)
-                VirtualTerminal::jumpToVt(disp, true);
+                daemonApp->vtSwitcher()->jumpToVt(disp, true);
         }
     }
+
+    void Seat::greeterFailed() {
+        // the display server is fine, bring back just the greeter
+        restartGreeter(qobject_cast<Display *>(sender()));
+    }
+
+    void Seat::restartGreeter(const QPointer<Display> &display) {
+        m_supervisor->failed(SeatSupervisor::GreeterLayer, [this, display]() {
+            // gone meanwhile, restarting the display takes care of it
+            if (!display)
+                return;
+
+            // the supervisor hears back once the greeter connects
+            if (display->restartGreeter())
+                daemonApp->metrics()->count(Metrics::GreeterRestarts, m_name);
+            else
+                restartGreeter(display);
+        });
+    }
 }
@@ -21,10 +21,13 @@
 #define SDDM_SEAT_H
 
 #include <QObject>
+#include <QPointer>
+#include <QProcessEnvironment>
 #include <QVector>
 
 namespace SDDM {
     class Display;
+    class SeatSupervisor;
 
     class Seat : public QObject {
         Q_OBJECT
@@ -34,18 +37,37 @@ namespace SDDM {
 
         const QString &name() const;
 
+        const QProcessEnvironment &systemEnvironment() const;
+        const QProcessEnvironment &greeterEnvironment() const;
+
+        SeatSupervisor *supervisor() const;
+
     public slots:
         bool createDisplay(int terminalId = -1);
         void removeDisplay(SDDM::Display* display);
 
+    signals:
+        void healthChanged(const QString &health);
+
     private slots:
         void displayStopped();
+        void greeterFailed();
 
     private:
+        void updateGreeterEnvironment();
+        bool startDisplay(int terminalId);
+        void restartDisplay();
+        void restartGreeter(const QPointer<Display> &display);
+
         QString m_name;
 
+        QProcessEnvironment m_systemEnvironment;
+        QProcessEnvironment m_greeterEnvironment;
+
         QVector<Display *> m_displays;
         QVector<int> m_terminalIds;
+
+        SeatSupervisor *m_supervisor { nullptr };
     };
 }
 
@@ -21,12 +21,16 @@
 
 #include "Configuration.h"
 #include "DaemonApp.h"
+#include "LogCategories.h"
+#include "ParentDisplayServer.h"
 #include "Seat.h"
+#include "SeatSupervisor.h"
 
 #include <QDBusConnection>
 #include <QDBusMessage>
 #include <QDBusPendingReply>
 #include <QDBusContext>
+#include <QFile>
 
 #include "LogindDBusTypes.h"
 
@@ -94,7 +98,63 @@ namespace SDDM {
         }
     }
 
+    // startseat=true|false on the kernel command line overrides EnableNesting
+    static bool nestingEnabled() {
+        QFile cmdline(QStringLiteral("/proc/cmdline"));
+        if (cmdline.open(QIODevice::ReadOnly)) {
+            const QList<QByteArray> params = cmdline.readAll().simplified().split(' ');
+            for (const QByteArray &param : params) {
+                if (param.startsWith("startseat="))
+                    return param.mid(10) == "true";
+            }
+        }
+
+        return mainConfig.X11.EnableNesting.get();
+    }
+
+    SeatManager::~SeatManager() {
+        if (!m_parentServer)
+            return;
+
+        // the nested seats go before the server they run in
+        m_parentServer->disconnect(this);
+        qDeleteAll(m_seats);
+        m_seats.clear();
+        delete m_parentServer;
+    }
+
+    bool SeatManager::nesting() const {
+        return m_nesting;
+    }
+
+    ParentDisplayServer *SeatManager::parentServer() const {
+        return m_parentServer;
+    }
+
+    QString SeatManager::health(const QString &name) const {
+        if (m_pendingSeats.contains(name))
+            return QStringLiteral("waiting");
+
+        Seat *seat = m_seats.value(name);
+        return seat ? seat->supervisor()->health() : QStringLiteral("stopped");
+    }
+
+    uint SeatManager::restarts(const QString &name) const {
+        Seat *seat = m_seats.value(name);
+        return seat ? seat->supervisor()->restarts() : 0;
+    }
+
     void SeatManager::initialize() {
+        m_nesting = !DaemonApp::instance()->testing() && nestingEnabled();
+        if (m_nesting) {
+            // start the parent right away, nested seats are created once it's ready
+            m_parentServer = new ParentDisplayServer(this);
+            m_parentSupervisor = new SeatSupervisor(QStringLiteral("seat0"), this);
+            connect(m_parentServer, &ParentDisplayServer::started, this, &SeatManager::parentServerStarted);
+            connect(m_parentServer, &ParentDisplayServer::stopped, this, &SeatManager::parentServerStopped);
+            startParentServer();
+        }
+
         if (DaemonApp::instance()->testing() || !Logind::isAvailable()) {
             //if we don't have logind/CK2, just create a single seat immediately and don't do any other connections
             createSeat(QStringLiteral("seat0"));
@@ -124,19 +184,38 @@ namespace SDDM {
     }
 
     void SeatManager::createSeat(const QString &name) {
-        if (!mainConfig.X11.EnableNesting.get() || name != QLatin1String("seat0")) {
-            // create a seat
-            Seat *seat = new Seat(name, this);
-
-            // add to the list
-            m_seats.insert(name, seat);
+        if (m_nesting) {
+            // seat0 is taken by the parent server
+            if (name == QLatin1String("seat0"))
+                return;
 
-            // emit signal
-            emit seatCreated(name);
+            if (!m_parentServer->isReady()) {
+                if (!m_pendingSeats.contains(name))
+                    m_pendingSeats << name;
+                return;
+            }
         }
+
+        // check if seat exists
+        if (m_seats.contains(name))
+            return;
+
+        // create a seat
+        Seat *seat = new Seat(name, this);
+        connect(seat, &Seat::healthChanged, this, [this, name](const QString &health) {
+            emit seatHealthChanged(name, health);
+        });
+
+        // add to the list
+        m_seats.insert(name, seat);
+
+        // emit signal
+        emit seatCreated(name);
     }
 
     void SeatManager::removeSeat(const QString &name) {
+        m_pendingSeats.removeAll(name);
+
         // check if seat exists
         if (!m_seats.contains(name))
             return;
@@ -174,6 +253,37 @@ namespace SDDM {
         m_systemSeats.insert(name, logindSeat);
     }
 
+    void SeatManager::startParentServer() {
+        // failing before the process runs doesn't emit stopped()
+        if (!m_parentServer->start())
+            parentServerStopped();
+    }
+
+    void SeatManager::parentServerStarted() {
+        m_parentSupervisor->started();
+
+        qCDebug(lcSeat) << "Parent display server is ready, starting nested seats" << m_pendingSeats;
+
+        const QStringList pending = m_pendingSeats;
+        m_pendingSeats.clear();
+        for (const QString &name : pending)
+            createSeat(name);
+    }
+
+    void SeatManager::parentServerStopped() {
+        qCWarning(lcSeat) << "Parent display server stopped, restarting nested seats";
+
+        // the nested servers are going down with the parent, stop their
+        // seats in one go and bring them back once the parent is up again
+        const QStringList names = m_seats.keys();
+        for (const QString &name : names) {
+            removeSeat(name);
+            m_pendingSeats << name;
+        }
+
+        m_parentSupervisor->failed(SeatSupervisor::DisplayServerLayer, [this]() { startParentServer(); });
+    }
+
     void SDDM::SeatManager::logindSeatRemoved(const QString& name, const QDBusObjectPath& objectPath)
     {
         Q_UNUSED(objectPath);
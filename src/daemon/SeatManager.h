@@ -23,17 +23,26 @@
 #include <QObject>
 #include <QHash>
 #include <QDBusObjectPath>
+#include <QStringList>
 
 namespace SDDM {
     class Seat;
     class LogindSeat;
+    class ParentDisplayServer;
+    class SeatSupervisor;
 
     class SeatManager : public QObject {
         Q_OBJECT
     public:
         explicit SeatManager(QObject *parent = 0) : QObject(parent) {}
+        ~SeatManager();
 
         void initialize();
+        // whether the seats are nested in a parent X server on seat0
+        bool nesting() const;
+        ParentDisplayServer *parentServer() const;
+        QString health(const QString &name) const;
+        uint restarts(const QString &name) const;
         void createSeat(const QString &name);
         void removeSeat(const QString &name);
         void switchToGreeter(const QString &seat);
@@ -41,12 +50,20 @@ namespace SDDM {
     Q_SIGNALS:
         void seatCreated(const QString &name);
         void seatRemoved(const QString &name);
+        void seatHealthChanged(const QString &name, const QString &health);
 
     private Q_SLOTS:
         void logindSeatAdded(const QString &name, const QDBusObjectPath &objectPath);
         void logindSeatRemoved(const QString &name, const QDBusObjectPath &objectPath);
+        void startParentServer();
+        void parentServerStarted();
+        void parentServerStopped();
 
     private:
+        bool m_nesting { false };
+        ParentDisplayServer *m_parentServer { nullptr };
+        SeatSupervisor *m_parentSupervisor { nullptr };
+        QStringList m_pendingSeats; //nested seats waiting for the parent server
         QHash<QString, Seat *> m_seats; //these will exist only for graphical seats
         QHash<QString, LogindSeat*> m_systemSeats; //these will exist for all seats
     };
@@ -0,0 +1,116 @@
+/***************************************************************************
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+
+#include "SeatSupervisor.h"
+
+#include "LogCategories.h"
+
+#include <QDebug>
+#include <QTimer>
+
+namespace SDDM {
+    // first retry delay, doubled for every failure in a row
+    static const int initialDelay = 1000;
+    static const int maximumDelay = 60000;
+    // up for this long, the next failure starts the backoff over
+    static const int stableTime = 60000;
+    // this many failures within the window make a crash loop
+    static const int crashLoopFailures = 5;
+    static const int crashLoopWindow = 120000;
+    static const int crashLoopDelay = 300000;
+
+    SeatSupervisor::SeatSupervisor(const QString &seat, QObject *parent) : QObject(parent),
+        m_seat(seat),
+        m_health(QStringLiteral("stopped")),
+        m_timer(new QTimer(this)) {
+        m_clock.start();
+
+        m_timer->setSingleShot(true);
+        connect(m_timer, &QTimer::timeout, this, [this]() {
+            std::function<void()> restart = m_restart;
+            m_restart = nullptr;
+            m_restarts++;
+            if (restart)
+                restart();
+        });
+    }
+
+    const QString &SeatSupervisor::health() const {
+        return m_health;
+    }
+
+    uint SeatSupervisor::restarts() const {
+        return m_restarts;
+    }
+
+    void SeatSupervisor::started() {
+        m_upTimer.start();
+        setHealth(QStringLiteral("running"));
+    }
+
+    void SeatSupervisor::failed(Layer layer, const std::function<void()> &restart) {
+        // the greeter noticed its display server going away first, it's
+        // still one failure, the display server restart replaces the other
+        if (m_timer->isActive() && m_pendingLayer == GreeterLayer && layer == DisplayServerLayer) {
+            m_pendingLayer = layer;
+            m_restart = restart;
+            return;
+        }
+
+        const qint64 now = m_clock.elapsed();
+
+        // a seat that was up long enough failed for a new reason
+        if (m_upTimer.isValid() && m_upTimer.elapsed() >= stableTime)
+            m_consecutiveFailures = 0;
+        m_upTimer.invalidate();
+        m_consecutiveFailures++;
+
+        m_recentFailures.enqueue(now);
+        while (now - m_recentFailures.head() > crashLoopWindow)
+            m_recentFailures.dequeue();
+
+        int delay;
+        if (m_recentFailures.size() >= crashLoopFailures) {
+            delay = crashLoopDelay;
+            if (m_health != QLatin1String("crash-loop"))
+                qCCritical(lcSeat) << "Seat" << m_seat << "failed" << m_recentFailures.size()
+                                   << "times within" << crashLoopWindow / 1000 << "seconds, retrying every"
+                                   << crashLoopDelay / 1000 << "seconds";
+            setHealth(QStringLiteral("crash-loop"));
+        } else {
+            delay = qMin(initialDelay << qMin(m_consecutiveFailures - 1, 16), maximumDelay);
+            setHealth(QStringLiteral("restarting"));
+        }
+
+        qCWarning(lcSeat) << (layer == GreeterLayer ? "Greeter" : "Display server") << "on" << m_seat
+                          << "failed, restarting it in" << delay << "ms";
+
+        m_pendingLayer = layer;
+        m_restart = restart;
+        m_timer->start(delay);
+    }
+
+    void SeatSupervisor::setHealth(const QString &health) {
+        if (m_health == health)
+            return;
+
+        m_health = health;
+        emit healthChanged(m_health);
+    }
+}
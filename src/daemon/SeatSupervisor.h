@@ -0,0 +1,82 @@
+/***************************************************************************
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+
+#ifndef SDDM_SEATSUPERVISOR_H
+#define SDDM_SEATSUPERVISOR_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QQueue>
+
+#include <functional>
+
+class QTimer;
+
+namespace SDDM {
+    /*!
+     \brief Restarts the failed layer of a seat with exponential backoff
+
+     Each failure of the display server or the greeter schedules a restart
+     of just that layer. The delay doubles with every failure in a row and
+     starts over once the seat stayed up for a while. Too many failures in
+     a short time are treated as a crash loop, which is only retried at
+     long intervals so that it doesn't keep the machine busy.
+    */
+    class SeatSupervisor : public QObject {
+        Q_OBJECT
+        Q_DISABLE_COPY(SeatSupervisor)
+    public:
+        enum Layer {
+            DisplayServerLayer,
+            GreeterLayer
+        };
+
+        explicit SeatSupervisor(const QString &seat, QObject *parent = 0);
+
+        // "running", "restarting", "crash-loop" or "stopped"
+        const QString &health() const;
+        uint restarts() const;
+
+        // the layer is up (again)
+        void started();
+        // the layer went down unexpectedly, restart is called when it's due
+        void failed(Layer layer, const std::function<void()> &restart);
+
+    signals:
+        void healthChanged(const QString &health);
+
+    private:
+        void setHealth(const QString &health);
+
+        QString m_seat;
+        QString m_health;
+        uint m_restarts { 0 };
+        int m_consecutiveFailures { 0 };
+        Layer m_pendingLayer { DisplayServerLayer };
+
+        QElapsedTimer m_upTimer;
+        QQueue<qint64> m_recentFailures;
+        QElapsedTimer m_clock;
+
+        QTimer *m_timer { nullptr };
+        std::function<void()> m_restart;
+    };
+}
+
+#endif // SDDM_SEATSUPERVISOR_H
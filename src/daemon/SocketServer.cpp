@@ -20,12 +20,11 @@
 
 #include "SocketServer.h"
 
-#include "DaemonApp.h"
-#include "Messages.h"
-#include "PowerManager.h"
+#include "LogCategories.h"
 #include "SocketWriter.h"
 #include "Utils.h"
 
+#include <QFileInfo>
 #include <QLocalServer>
 
 namespace SDDM {
@@ -46,7 +45,7 @@ namespace SDDM {
         QString socketName = QStringLiteral("sddm-%1-%2").arg(displayName).arg(generateName(6));
 
         // log message
-        qDebug() << "Socket server starting...";
+        qCDebug(lcSocket) << "Socket server starting...";
 
         // create server
         m_server = new QLocalServer(this);
@@ -57,7 +56,7 @@ namespace SDDM {
         // start listening
         if (!m_server->listen(socketName)) {
             // log message
-            qCritical() << "Failed to start socket server.";
+            qCCritical(lcSocket) << "Failed to start socket server.";
 
             // return fail
             return false;
@@ -65,7 +64,7 @@ namespace SDDM {
 
 
         // log message
-        qDebug() << "Socket server started.";
+        qCDebug(lcSocket) << "Socket server started.";
 
         // connect signals
         connect(m_server, &QLocalServer::newConnection, this, &SocketServer::newConnection);
@@ -80,14 +79,38 @@ namespace SDDM {
             return;
 
         // log message
-        qDebug() << "Socket server stopping...";
+        qCDebug(lcSocket) << "Socket server stopping...";
 
         // delete server
         m_server->deleteLater();
         m_server = nullptr;
 
+        // forget about greeters still waiting for the display
+        m_readyDisplay.clear();
+        m_waitingSockets.clear();
+        m_readers.clear();
+
         // log message
-        qDebug() << "Socket server stopped.";
+        qCDebug(lcSocket) << "Socket server stopped.";
+    }
+
+    void SocketServer::setHostName(const QString &hostName) {
+        m_hostName = hostName;
+    }
+
+    void SocketServer::setCapabilities(Capabilities capabilities) {
+        m_capabilities = capabilities;
+    }
+
+    void SocketServer::setDisplayReady(const QString &displayName) {
+        m_readyDisplay = displayName;
+
+        // wake up greeters that were started before the display server
+        for (const QPointer<QLocalSocket> &socket : qAsConst(m_waitingSockets)) {
+            if (socket)
+                SocketWriter(socket) << quint32(DaemonMessages::DisplayReady) << m_readyDisplay;
+        }
+        m_waitingSockets.clear();
     }
 
     void SocketServer::newConnection() {
@@ -97,6 +120,9 @@ namespace SDDM {
         // connect signals
         connect(socket, &QLocalSocket::readyRead, this, &SocketServer::readyRead);
         connect(socket, &QLocalSocket::disconnected, socket, &QLocalSocket::deleteLater);
+        connect(socket, &QObject::destroyed, this, [this, socket] {
+            m_readers.remove(socket);
+        });
     }
 
     void SocketServer::readyRead() {
@@ -106,9 +132,28 @@ namespace SDDM {
         if (!socket)
             return;
 
-        // input stream
-        QDataStream input(socket);
+        // messages may arrive split or several at once
+        SocketReader &reader = m_readers[socket];
+        reader.append(socket->readAll());
+
+        QByteArray message;
+        while (reader.next(message)) {
+            QDataStream input(message);
+            input.setVersion(ProtocolStreamVersion);
+            processMessage(socket, input);
+        }
 
+        if (reader.hasError()) {
+            // log message
+            qCWarning(lcSocket) << "Malformed message from greeter, closing connection";
+
+            // drop the connection
+            m_readers.remove(socket);
+            socket->abort();
+        }
+    }
+
+    void SocketServer::processMessage(QLocalSocket *socket, QDataStream &input) {
         // read message
         quint32 message;
         input >> message;
@@ -116,13 +161,23 @@ namespace SDDM {
         switch (GreeterMessages(message)) {
             case GreeterMessages::Connect: {
                 // log message
-                qDebug() << "Message received from greeter: Connect";
-
-                // send capabilities
-                SocketWriter(socket) << quint32(DaemonMessages::Capabilities) << quint32(daemonApp->powerManager()->capabilities());
-
-                // send host name
-                SocketWriter(socket) << quint32(DaemonMessages::HostName) << daemonApp->hostName();
+                qCDebug(lcSocket) << "Message received from greeter: Connect";
+
+                // the version both sides speak, every framed greeter knows 1
+                quint32 version = 1;
+                input >> version;
+                version = qBound(quint32(1), version, ProtocolVersion);
+                const quint32 capabilities = m_capabilities;
+
+                // answer in that version, along with the host name in one write
+                SocketWriter writer(socket);
+                if (version >= 2) {
+                    writer << quint32(DaemonMessages::Welcome) << version << capabilities;
+                } else {
+                    writer << quint32(DaemonMessages::Version) << version;
+                    writer.nextMessage() << quint32(DaemonMessages::Capabilities) << capabilities;
+                }
+                writer.nextMessage() << quint32(DaemonMessages::HostName) << m_hostName;
 
                 // emit signal
                 emit connected();
@@ -130,60 +185,111 @@ namespace SDDM {
             break;
             case GreeterMessages::Login: {
                 // log message
-                qDebug() << "Message received from greeter: Login";
+                qCDebug(lcSocket) << "Message received from greeter: Login";
 
                 // read username, pasword etc.
-                QString user, password, filename;
-                Session session;
-                input >> user >> password >> session;
+                QString user, password, fileName;
+                quint32 type;
+                input >> user >> password >> type >> fileName;
+
+                // resolve the session key against the configured session
+                // directories, parsed entries are cached by Session
+                Session session(static_cast<Session::Type>(type), QFileInfo(fileName).fileName());
 
                 // emit signal
                 emit login(socket, user, password, session);
             }
             break;
+            case GreeterMessages::PrepareLogin: {
+                // log message
+                qCDebug(lcSocket) << "Message received from greeter: PrepareLogin";
+
+                // read username and session, the password comes with Login
+                QString user, fileName;
+                quint32 type;
+                input >> user >> type >> fileName;
+
+                Session session(static_cast<Session::Type>(type), QFileInfo(fileName).fileName());
+
+                // emit signal
+                emit prepareLogin(socket, user, session);
+            }
+            break;
             case GreeterMessages::PowerOff: {
                 // log message
-                qDebug() << "Message received from greeter: PowerOff";
+                qCDebug(lcSocket) << "Message received from greeter: PowerOff";
 
-                // power off
-                daemonApp->powerManager()->powerOff();
+                // emit signal
+                emit powerOff();
             }
             break;
             case GreeterMessages::Reboot: {
                 // log message
-                qDebug() << "Message received from greeter: Reboot";
+                qCDebug(lcSocket) << "Message received from greeter: Reboot";
 
-                // reboot
-                daemonApp->powerManager()->reboot();
+                // emit signal
+                emit reboot();
             }
             break;
             case GreeterMessages::Suspend: {
                 // log message
-                qDebug() << "Message received from greeter: Suspend";
+                qCDebug(lcSocket) << "Message received from greeter: Suspend";
 
-                // suspend
-                daemonApp->powerManager()->suspend();
+                // emit signal
+                emit suspend();
             }
             break;
             case GreeterMessages::Hibernate: {
                 // log message
-                qDebug() << "Message received from greeter: Hibernate";
+                qCDebug(lcSocket) << "Message received from greeter: Hibernate";
 
-                // hibernate
-                daemonApp->powerManager()->hibernate();
+                // emit signal
+                emit hibernate();
             }
             break;
             case GreeterMessages::HybridSleep: {
                 // log message
-                qDebug() << "Message received from greeter: HybridSleep";
+                qCDebug(lcSocket) << "Message received from greeter: HybridSleep";
 
-                // hybrid sleep
-                daemonApp->powerManager()->hybridSleep();
+                // emit signal
+                emit hybridSleep();
             }
             break;
-            default: {
+            case GreeterMessages::WaitForDisplay: {
                 // log message
-                qWarning() << "Unknown message" << message;
+                qCDebug(lcSocket) << "Message received from greeter: WaitForDisplay";
+
+                // answer right away if the display server is already up,
+                // otherwise the reply is sent by setDisplayReady()
+                if (!m_readyDisplay.isEmpty())
+                    SocketWriter(socket) << quint32(DaemonMessages::DisplayReady) << m_readyDisplay;
+                else
+                    m_waitingSockets << socket;
+            }
+            break;
+            case GreeterMessages::StartupTimings: {
+                // log message
+                qCDebug(lcSocket) << "Message received from greeter: StartupTimings";
+
+                // read the named steps and their times
+                quint32 count;
+                input >> count;
+
+                QList<QPair<QString, quint32>> timings;
+                for (quint32 i = 0; i < count && input.status() == QDataStream::Ok; ++i) {
+                    QString name;
+                    quint32 msecs;
+                    input >> name >> msecs;
+                    timings << qMakePair(name, msecs);
+                }
+
+                // emit signal
+                emit greeterStartup(timings);
+            }
+            break;
+            default: {
+                // log message, the frame is skipped as a whole
+                qCWarning(lcSocket) << "Unknown message" << message;
             }
         }
     }
@@ -21,11 +21,18 @@
 #ifndef SDDM_SOCKETSERVER_H
 #define SDDM_SOCKETSERVER_H
 
+#include <QHash>
+#include <QList>
 #include <QObject>
+#include <QPair>
+#include <QPointer>
 #include <QString>
 
+#include "Messages.h"
 #include "Session.h"
+#include "SocketReader.h"
 
+class QDataStream;
 class QLocalServer;
 class QLocalSocket;
 
@@ -41,6 +48,12 @@ namespace SDDM {
 
         QString socketAddress() const;
 
+        // sent to greeters when they connect
+        void setHostName(const QString &hostName);
+        void setCapabilities(Capabilities capabilities);
+
+        void setDisplayReady(const QString &displayName);
+
     private slots:
         void newConnection();
         void readyRead();
@@ -52,10 +65,27 @@ namespace SDDM {
         void login(QLocalSocket *socket,
                    const QString &user, const QString &password,
                    const Session &session);
+        void prepareLogin(QLocalSocket *socket,
+                          const QString &user, const Session &session);
         void connected();
+        void powerOff();
+        void reboot();
+        void suspend();
+        void hibernate();
+        void hybridSleep();
+        void greeterStartup(const QList<QPair<QString, quint32>> &timings);
 
     private:
+        void processMessage(QLocalSocket *socket, QDataStream &input);
+
         QLocalServer *m_server { nullptr };
+        QHash<QLocalSocket *, SocketReader> m_readers;
+
+        QString m_hostName;
+        Capabilities m_capabilities { Capability::None };
+
+        QString m_readyDisplay;
+        QList<QPointer<QLocalSocket>> m_waitingSockets;
     };
 }
 
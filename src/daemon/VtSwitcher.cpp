@@ -0,0 +1,195 @@
+/***************************************************************************
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+
+#include "VtSwitcher.h"
+
+#include "LogCategories.h"
+#include "VirtualTerminal.h"
+
+#include <QMutex>
+#include <QThread>
+#include <QTimer>
+
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+
+namespace SDDM {
+    // how long a VT owner gets to release the VT
+    static const int SwitchTimeout = 5000;
+    // VT_GETSTATE polling interval when VT_WAITEVENT is not available
+    static const int PollInterval = 100;
+    // sent to the monitor thread to get it out of VT_WAITEVENT
+    static const int WakeUpSignal = SIGUSR2;
+
+    static void wakeUp(int) {
+    }
+
+    class VtSwitcher::Monitor : public QThread {
+        Q_OBJECT
+    public:
+        explicit Monitor(int activeVt) : m_activeVt(activeVt) { }
+
+        // interrupts a wait for VT events and joins the thread
+        void stop() {
+            requestInterruption();
+            while (!wait(PollInterval)) {
+                QMutexLocker locker(&m_threadMutex);
+                if (m_running)
+                    pthread_kill(m_thread, WakeUpSignal);
+            }
+        }
+
+    signals:
+        void vtChanged(int vt);
+
+    protected:
+        void run() override {
+            {
+                QMutexLocker locker(&m_threadMutex);
+                m_thread = pthread_self();
+                m_running = true;
+            }
+
+            bool events = true;
+            while (!isInterruptionRequested()) {
+                int vt = -1;
+                if (events) {
+                    vt = VirtualTerminal::waitForSwitch();
+                    if (vt < 0) {
+                        qCDebug(lcSeat) << "VT events not available, polling the active VT";
+                        events = false;
+                    }
+                }
+                // polling for good, or once after an interrupted wait
+                if (vt <= 0) {
+                    msleep(PollInterval);
+                    vt = VirtualTerminal::activeVt();
+                }
+
+                if (vt > 0 && vt != m_activeVt) {
+                    m_activeVt = vt;
+                    emit vtChanged(vt);
+                }
+            }
+
+            QMutexLocker locker(&m_threadMutex);
+            m_running = false;
+        }
+
+    private:
+        int m_activeVt { -1 };
+
+        QMutex m_threadMutex;
+        pthread_t m_thread;
+        bool m_running { false };
+    };
+
+    VtSwitcher::VtSwitcher(QObject *parent) : QObject(parent), m_timer(new QTimer(this)) {
+        m_timer->setSingleShot(true);
+        m_timer->setInterval(SwitchTimeout);
+        connect(m_timer, &QTimer::timeout, this, &VtSwitcher::timedOut);
+
+        // without a console there is nothing to monitor (e.g. test mode)
+        m_activeVt = VirtualTerminal::activeVt();
+        if (m_activeVt < 0)
+            return;
+
+        // no SA_RESTART, the signal has to make VT_WAITEVENT return
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = wakeUp;
+        sigemptyset(&action.sa_mask);
+        sigaction(WakeUpSignal, &action, nullptr);
+
+        m_monitor = new Monitor(m_activeVt);
+        connect(m_monitor, &Monitor::vtChanged, this, &VtSwitcher::vtChanged);
+        m_monitor->start();
+    }
+
+    VtSwitcher::~VtSwitcher() {
+        if (!m_monitor)
+            return;
+
+        m_monitor->disconnect(this);
+        m_monitor->stop();
+        delete m_monitor;
+    }
+
+    int VtSwitcher::activeVt() const {
+        return m_activeVt;
+    }
+
+    void VtSwitcher::jumpToVt(int vt, bool vt_auto) {
+        // a newer request replaces one still waiting
+        if (m_pendingVt != -1 && m_pendingVt != vt)
+            finish(false);
+
+        if (!VirtualTerminal::activateVt(vt, vt_auto)) {
+            emit switched(vt, false);
+            return;
+        }
+
+        m_pendingVt = vt;
+
+        // the switch may have happened already
+        if (VirtualTerminal::activeVt() == vt) {
+            vtChanged(vt);
+            return;
+        }
+
+        m_timer->start();
+    }
+
+    void VtSwitcher::vtChanged(int vt) {
+        if (vt != m_activeVt) {
+            m_activeVt = vt;
+            emit activeVtChanged(vt);
+        }
+
+        if (vt == m_pendingVt)
+            finish(true);
+    }
+
+    void VtSwitcher::timedOut() {
+        if (m_pendingVt == -1)
+            return;
+
+        // a switch the monitor didn't catch up with yet
+        if (VirtualTerminal::activeVt() == m_pendingVt) {
+            vtChanged(m_pendingVt);
+            return;
+        }
+
+        qCWarning(lcSeat) << "VT" << m_pendingVt << "didn't become active within" << SwitchTimeout << "ms";
+        finish(false);
+    }
+
+    void VtSwitcher::finish(bool success) {
+        int vt = m_pendingVt;
+        m_pendingVt = -1;
+        m_timer->stop();
+
+        if (success)
+            qCDebug(lcSeat) << "Switched to VT" << vt;
+        emit switched(vt, success);
+    }
+}
+
+#include "VtSwitcher.moc"
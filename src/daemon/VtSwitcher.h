@@ -0,0 +1,69 @@
+/***************************************************************************
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+
+#ifndef SDDM_VTSWITCHER_H
+#define SDDM_VTSWITCHER_H
+
+#include <QObject>
+
+class QTimer;
+
+namespace SDDM {
+    /**
+     * Switches VTs without blocking the daemon.
+     *
+     * The switch is only initiated on the calling thread. A monitor
+     * thread waits for the kernel to report VT switches (VT_WAITEVENT,
+     * polling VT_GETSTATE where that is not available) and completes the
+     * request, or it times out. A VT whose owner never releases it can't
+     * hold up the event loop and with it every other seat.
+     */
+    class VtSwitcher : public QObject {
+        Q_OBJECT
+        Q_DISABLE_COPY(VtSwitcher)
+    public:
+        explicit VtSwitcher(QObject *parent = 0);
+        ~VtSwitcher();
+
+        int activeVt() const;
+
+    public slots:
+        void jumpToVt(int vt, bool vt_auto);
+
+    signals:
+        void activeVtChanged(int vt);
+        void switched(int vt, bool success);
+
+    private slots:
+        void vtChanged(int vt);
+        void timedOut();
+
+    private:
+        class Monitor;
+
+        void finish(bool success);
+
+        Monitor *m_monitor { nullptr };
+        QTimer *m_timer { nullptr };
+        int m_activeVt { -1 };
+        int m_pendingVt { -1 };
+    };
+}
+
+#endif // SDDM_VTSWITCHER_H
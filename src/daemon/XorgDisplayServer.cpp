@@ -23,12 +23,17 @@
 #include "Configuration.h"
 #include "DaemonApp.h"
 #include "Display.h"
+#include "LogCategories.h"
+#include "Metrics.h"
+#include "ParentDisplayServer.h"
 #include "SignalHandler.h"
 #include "Seat.h"
+#include "SeatManager.h"
 
 #include <QDebug>
 #include <QFile>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QProcess>
 #include <QUuid>
 
@@ -90,7 +95,7 @@ namespace SDDM {
 
     bool XorgDisplayServer::addCookie(const QString &file) {
         // log message
-        qDebug() << "Adding cookie to" << file;
+        qCDebug(lcXorg) << "Adding cookie to" << file;
 
         // Touch file
         QFile file_handler(file);
@@ -113,6 +118,17 @@ namespace SDDM {
         return pclose(fp) == 0;
     }
 
+    bool XorgDisplayServer::assignDisplay() {
+        // only nested servers have a display number known in advance,
+        // the others tell us which one they took through -displayfd
+        if (!daemonApp->seatManager()->nesting())
+            return false;
+
+        m_display = QStringLiteral(":") +
+                    QString::number(displayPtr()->seat()->name().mid(4).toInt() + 1);
+        return true;
+    }
+
     bool XorgDisplayServer::start() {
         // check flag
         if (m_started)
@@ -125,27 +141,33 @@ namespace SDDM {
         connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, &XorgDisplayServer::finished);
 
         // log message
-        qDebug() << "Display server starting...";
+        qCDebug(lcXorg) << "Display server starting...";
+
+        QElapsedTimer startTimer;
+        startTimer.start();
 
         // generate auth file.
         // For the X server's copy, the display number doesn't matter.
         // An empty file would result in no access control!
         m_display = QStringLiteral(":0");
         if(!addCookie(m_authPath)) {
-            qCritical() << "Failed to write xauth file";
+            qCCritical(lcXorg) << "Failed to write xauth file";
             return false;
         }
 
         // set process environment
-        QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+        QProcessEnvironment env = displayPtr()->seat()->systemEnvironment();
         env.insert(QStringLiteral("XCURSOR_THEME"), mainConfig.Theme.CursorTheme.get());
+        // the nested driver draws into the parent server
+        if (daemonApp->seatManager()->nesting())
+            daemonApp->seatManager()->parentServer()->addToEnvironment(env);
         process->setProcessEnvironment(env);
 
         //create pipe for communicating with X server
         //0 == read from X, 1== write to from X
         int pipeFds[2];
         if (pipe(pipeFds) != 0) {
-            qCritical("Could not create pipe to start X server");
+            qCCritical(lcXorg, "Could not create pipe to start X server");
         }
 
         // start display server
@@ -155,9 +177,7 @@ namespace SDDM {
             args << mainConfig.X11.ServerArguments.get().split(QLatin1Char(' '), QString::SkipEmptyParts)
                  << QStringLiteral("-background") << QStringLiteral("none")
                  << QStringLiteral("-seat") << displayPtr()->seat()->name();
-            if (mainConfig.X11.EnableNesting.get()) {
-                m_display = QStringLiteral(":") +
-                            QString::number(displayPtr()->seat()->name().mid(4).toInt() + 1);
+            if (assignDisplay()) {
                 args << m_display
                      << QStringLiteral("-config")
                      << mainConfig.X11.SeatConfDir.get() + QStringLiteral("/") + displayPtr()->seat()->name() + QStringLiteral(".conf")
@@ -185,62 +205,71 @@ namespace SDDM {
         args << QStringLiteral("-auth") << m_authPath;
 
         process->setArguments(args);
-        qDebug() << "Running:"
+        qCDebug(lcXorg) << "Running:"
             << qPrintable(process->program())
             << qPrintable(process->arguments().join(QLatin1Char(' ')));
         process->start();
 
-        // wait for display server to start
-        if (!process->waitForStarted()) {
-            // log message
-            qCritical() << "Failed to start display server process.";
-
-            // return fail
-            close(pipeFds[0]);
-            return false;
-        }
-
-        // close the other side of pipe in our process, otherwise reading
-        // from it may stuck even X server exit.
-        close(pipeFds[1]);
-
-        if (!mainConfig.X11.EnableNesting.get()) {
-            QFile readPipe;
+        // blocks until the display number comes through the pipe, the
+        // scripts run from started() are timed on their own
+        {
+            BlockingCall blocking("xorg-start");
 
-            if (!readPipe.open(pipeFds[0], QIODevice::ReadOnly)) {
-                qCritical("Failed to open pipe to start X Server");
+            // wait for display server to start
+            if (!process->waitForStarted()) {
+                // log message
+                qCCritical(lcXorg) << "Failed to start display server process.";
 
+                // return fail
                 close(pipeFds[0]);
                 return false;
             }
-            QByteArray displayNumber = readPipe.readLine();
-            if (displayNumber.size() < 2) {
-                // X server gave nothing (or a whitespace).
-                qCritical("Failed to read display number from pipe");
 
-                close(pipeFds[0]);
-                return false;
+            // close the other side of pipe in our process, otherwise reading
+            // from it may stuck even X server exit.
+            close(pipeFds[1]);
+
+            if (!daemonApp->seatManager()->nesting()) {
+                QFile readPipe;
+
+                if (!readPipe.open(pipeFds[0], QIODevice::ReadOnly)) {
+                    qCCritical(lcXorg, "Failed to open pipe to start X Server");
+
+                    close(pipeFds[0]);
+                    return false;
+                }
+                QByteArray displayNumber = readPipe.readLine();
+                if (displayNumber.size() < 2) {
+                    // X server gave nothing (or a whitespace).
+                    qCCritical(lcXorg, "Failed to read display number from pipe");
+
+                    close(pipeFds[0]);
+                    return false;
+                }
+                displayNumber.prepend(QByteArray(":"));
+                displayNumber.remove(displayNumber.size() -1, 1); // trim trailing whitespace
+                m_display = QString::fromLocal8Bit(displayNumber);
             }
-            displayNumber.prepend(QByteArray(":"));
-            displayNumber.remove(displayNumber.size() -1, 1); // trim trailing whitespace
-            m_display = QString::fromLocal8Bit(displayNumber);
         }
 
         // close our pipe
         close(pipeFds[0]);
 
-        emit started();
-
         // The file is also used by the greeter, which does care about the
         // display number. Write the proper entry, if it's different.
+        // This has to happen before anyone is told the server is up.
         if(m_display != QStringLiteral(":0")) {
             if(!addCookie(m_authPath)) {
-                qCritical() << "Failed to write xauth file";
+                qCCritical(lcXorg) << "Failed to write xauth file";
                 return false;
             }
         }
         changeOwner(m_authPath);
 
+        daemonApp->metrics()->observe(Metrics::XorgStartSeconds, displayPtr()->seat()->name(), startTimer.elapsed());
+
+        emit started();
+
         // set flag
         m_started = true;
 
@@ -254,12 +283,13 @@ namespace SDDM {
             return;
 
         // log message
-        qDebug() << "Display server stopping...";
+        qCDebug(lcXorg) << "Display server stopping...";
 
         // terminate process
         process->terminate();
 
         // wait for finished
+        BlockingCall blocking("xorg-stop");
         if (!process->waitForFinished(5000))
             process->kill();
     }
@@ -273,7 +303,7 @@ namespace SDDM {
         m_started = false;
 
         // log message
-        qDebug() << "Display server stopped.";
+        qCDebug(lcXorg) << "Display server stopped.";
 
         QString displayStopCommand = mainConfig.X11.DisplayStopCommand.get();
 
@@ -289,12 +319,15 @@ namespace SDDM {
         displayStopScript->setProcessEnvironment(env);
 
         // start display stop script
-        qDebug() << "Running display stop script " << displayStopCommand;
+        qCDebug(lcXorg) << "Running display stop script " << displayStopCommand;
         displayStopScript->start(displayStopCommand);
 
         // wait for finished
-        if (!displayStopScript->waitForFinished(5000))
-            displayStopScript->kill();
+        {
+            BlockingCall blocking("display-stop-script");
+            if (!displayStopScript->waitForFinished(5000))
+                displayStopScript->kill();
+        }
 
         // clean up the script process
         displayStopScript->deleteLater();
@@ -330,28 +363,34 @@ namespace SDDM {
         setCursor->setProcessEnvironment(env);
         displayScript->setProcessEnvironment(env);
 
-        qDebug() << "Setting default cursor";
+        qCDebug(lcXorg) << "Setting default cursor";
         setCursor->start(QStringLiteral("xsetroot -cursor_name left_ptr"));
 
         // delete setCursor on finish
         connect(setCursor, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), setCursor, &QProcess::deleteLater);
 
         // wait for finished
-        if (!setCursor->waitForFinished(1000)) {
-            qWarning() << "Could not setup default cursor";
-            setCursor->kill();
+        {
+            BlockingCall blocking("set-cursor");
+            if (!setCursor->waitForFinished(1000)) {
+                qCWarning(lcXorg) << "Could not setup default cursor";
+                setCursor->kill();
+            }
         }
 
         // start display setup script
-        qDebug() << "Running display setup script " << displayCommand;
+        qCDebug(lcXorg) << "Running display setup script " << displayCommand;
         displayScript->start(displayCommand);
 
         // delete displayScript on finish
         connect(displayScript, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), displayScript, &QProcess::deleteLater);
 
         // wait for finished
-        if (!displayScript->waitForFinished(30000))
-            displayScript->kill();
+        {
+            BlockingCall blocking("display-setup-script");
+            if (!displayScript->waitForFinished(30000))
+                displayScript->kill();
+        }
 
         // reload config if needed
         mainConfig.load();
@@ -361,10 +400,10 @@ namespace SDDM {
         // change the owner and group of the auth file to the sddm user
         struct passwd *pw = getpwnam("sddm");
         if (!pw)
-            qWarning() << "Failed to find the sddm user. Owner of the auth file will not be changed.";
+            qCWarning(lcXorg) << "Failed to find the sddm user. Owner of the auth file will not be changed.";
         else {
             if (chown(qPrintable(fileName), pw->pw_uid, pw->pw_gid) == -1)
-                qWarning() << "Failed to change owner of the auth file.";
+                qCWarning(lcXorg) << "Failed to change owner of the auth file.";
         }
     }
 }
@@ -42,6 +42,8 @@ namespace SDDM {
 
         bool addCookie(const QString &file);
 
+        bool assignDisplay();
+
     public slots:
         bool start();
         void stop();
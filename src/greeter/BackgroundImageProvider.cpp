@@ -0,0 +1,157 @@
+/***************************************************************************
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "BackgroundImageProvider.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QUrl>
+
+namespace SDDM {
+    static const quint32 CacheMagic = 0x53424731; // "SBG1"
+
+    BackgroundImageProvider::BackgroundImageProvider()
+        : QQuickImageProvider(QQuickImageProvider::Image, QQmlImageProviderBase::ForceAsynchronousImageLoading) {
+        // XDG_CACHE_HOME points to the persistent greeter cache
+        const QString cacheLocation = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+        if (!cacheLocation.isEmpty() && QDir().mkpath(cacheLocation + QStringLiteral("/backgrounds")))
+            m_cacheDir = cacheLocation + QStringLiteral("/backgrounds");
+    }
+
+    QImage BackgroundImageProvider::requestImage(const QString &id, QSize *size, const QSize &requestedSize) {
+        // the id is the absolute path of the image without its leading slash
+        const QString path = QLatin1Char('/') + QUrl::fromPercentEncoding(id.toUtf8());
+        const QFileInfo info(path);
+
+        QImage image;
+        if (!info.isFile()) {
+            qWarning() << "Background image not found:" << path;
+            return image;
+        }
+
+        // nothing to scale to, just decode it
+        if (requestedSize.width() <= 0 || requestedSize.height() <= 0) {
+            image.load(path);
+            if (size)
+                *size = image.size();
+            return image;
+        }
+
+        const QString fileName = cacheFile(info, requestedSize);
+        if (!fileName.isEmpty())
+            image = readCache(fileName);
+
+        if (image.isNull()) {
+            image = scaledImage(path, requestedSize);
+            if (!image.isNull() && !fileName.isEmpty())
+                writeCache(fileName, image);
+        }
+
+        if (size)
+            *size = image.size();
+        return image;
+    }
+
+    QString BackgroundImageProvider::cacheFile(const QFileInfo &info, const QSize &size) const {
+        if (m_cacheDir.isEmpty())
+            return QString();
+
+        const QString key = QString::fromLatin1(QCryptographicHash::hash(info.absoluteFilePath().toUtf8(),
+                                                                         QCryptographicHash::Sha1).toHex());
+        const QString prefix = QStringLiteral("%1-%2x%3-").arg(key).arg(size.width()).arg(size.height());
+        const QString name = prefix + QString::number(info.lastModified().toMSecsSinceEpoch());
+
+        // drop entries made from older versions of the same image
+        QDir dir(m_cacheDir);
+        const QStringList stale = dir.entryList({ prefix + QLatin1Char('*') }, QDir::Files);
+        for (const QString &entry : stale) {
+            if (entry != name)
+                dir.remove(entry);
+        }
+
+        return dir.absoluteFilePath(name);
+    }
+
+    QImage BackgroundImageProvider::scaledImage(const QString &path, const QSize &size) {
+        QImageReader reader(path);
+
+        // scale while decoding so that the image covers the screen,
+        // decoders like the JPEG one do most of the work for free
+        const QSize sourceSize = reader.size();
+        if (sourceSize.isValid()) {
+            const QSize targetSize = sourceSize.scaled(size, Qt::KeepAspectRatioByExpanding);
+            if (targetSize.width() < sourceSize.width())
+                reader.setScaledSize(targetSize);
+        }
+
+        QImage image = reader.read();
+        if (image.isNull()) {
+            qWarning() << "Failed to read background image" << path << ":" << reader.errorString();
+            return image;
+        }
+
+        // store it in a format that can be uploaded as is
+        return image.convertToFormat(image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied
+                                                             : QImage::Format_RGB32);
+    }
+
+    QImage BackgroundImageProvider::readCache(const QString &fileName) {
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadOnly))
+            return QImage();
+
+        QDataStream stream(&file);
+        quint32 magic, format;
+        qint32 width, height, bytesPerLine;
+        stream >> magic >> width >> height >> format >> bytesPerLine;
+        if (stream.status() != QDataStream::Ok || magic != CacheMagic)
+            return QImage();
+
+        QImage image(width, height, QImage::Format(format));
+        if (image.isNull() || image.bytesPerLine() != bytesPerLine)
+            return QImage();
+
+        const int length = bytesPerLine * height;
+        if (stream.readRawData(reinterpret_cast<char *>(image.bits()), length) != length)
+            return QImage();
+
+        return image;
+    }
+
+    void BackgroundImageProvider::writeCache(const QString &fileName, const QImage &image) {
+        QSaveFile file(fileName);
+        if (!file.open(QIODevice::WriteOnly))
+            return;
+
+        QDataStream stream(&file);
+        stream << CacheMagic << qint32(image.width()) << qint32(image.height())
+               << quint32(image.format()) << qint32(image.bytesPerLine());
+        stream.writeRawData(reinterpret_cast<const char *>(image.constBits()), image.bytesPerLine() * image.height());
+
+        if (!file.commit())
+            qWarning() << "Failed to write background cache" << fileName;
+    }
+}
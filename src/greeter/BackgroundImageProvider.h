@@ -0,0 +1,52 @@
+/***************************************************************************
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#ifndef SDDM_BACKGROUNDIMAGEPROVIDER_H
+#define SDDM_BACKGROUNDIMAGEPROVIDER_H
+
+#include <QQuickImageProvider>
+
+class QFileInfo;
+
+namespace SDDM {
+    /**
+     * Serves theme backgrounds scaled to the size of the screen.
+     *
+     * Images are decoded in QML's image loader thread and stored
+     * uncompressed in the greeter cache, keyed by source path,
+     * modification time and target size, so later starts only
+     * have to read them back.
+     */
+    class BackgroundImageProvider : public QQuickImageProvider {
+    public:
+        BackgroundImageProvider();
+
+        QImage requestImage(const QString &id, QSize *size, const QSize &requestedSize) override;
+
+    private:
+        QString m_cacheDir;
+
+        QString cacheFile(const QFileInfo &info, const QSize &size) const;
+
+        static QImage scaledImage(const QString &path, const QSize &size);
+        static QImage readCache(const QString &fileName);
+        static void writeCache(const QString &fileName, const QImage &image);
+    };
+}
+
+#endif // SDDM_BACKGROUNDIMAGEPROVIDER_H
@@ -19,22 +19,31 @@
 ***************************************************************************/
 
 #include "GreeterApp.h"
+#include "BackgroundImageProvider.h"
 #include "Configuration.h"
 #include "GreeterProxy.h"
+#include "LogCategories.h"
 #include "Constants.h"
 #include "ScreenModel.h"
 #include "SessionModel.h"
+#include "StartupProfiler.h"
 #include "ThemeConfig.h"
 #include "ThemeMetadata.h"
 #include "UserModel.h"
 #include "KeyboardModel.h"
+#include "Messages.h"
+#include "SocketReader.h"
+#include "SocketWriter.h"
 
 #include "MessageHandler.h"
 
 #include <QCommandLineParser>
+#include <QDataStream>
+#include <QFile>
 #include <QGuiApplication>
 #include <QQuickItem>
 #include <QQuickView>
+#include <QQmlComponent>
 #include <QQmlContext>
 #include <QQmlEngine>
 #include <QDebug>
@@ -43,8 +52,16 @@
 #include <QLibraryInfo>
 #include <QVersionNumber>
 #include <QSurfaceFormat>
+#include <QStyleHints>
 
 #include <iostream>
+#include <memory>
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
 
 #define TR(x) QT_TRANSLATE_NOOP("Command line parser", QStringLiteral(x))
 
@@ -54,16 +71,8 @@ namespace SDDM {
     GreeterApp::GreeterApp(QObject *parent)
         : QObject(parent)
     {
-        // Translations
-        // Components translation
-        m_components_tranlator = new QTranslator();
-        if (m_components_tranlator->load(QLocale::system(), QString(), QString(), QStringLiteral(COMPONENTS_TRANSLATION_DIR)))
-            QCoreApplication::installTranslator(m_components_tranlator);
-
-
-        // Create models
-        m_sessionModel = new SessionModel();
-        m_keyboard = new KeyboardModel();
+        // Nothing here may need the application object, in prepare
+        // mode we are created before QGuiApplication
     }
 
     bool GreeterApp::isTestModeEnabled() const
@@ -93,10 +102,21 @@ namespace SDDM {
 
     void GreeterApp::setThemePath(const QString &path)
     {
-        m_themePath = path;
-        if (m_themePath.isEmpty())
-            m_themePath = QLatin1String("qrc:/theme");
+        const QString themePath = path.isEmpty() ? QStringLiteral("qrc:/theme") : path;
+
+        // in prepare mode the theme has been read already
+        if (!m_metadata || m_themePath != themePath) {
+            m_themePath = themePath;
+            loadTheme();
+        }
 
+        // icons and translations need the application object
+        if (QCoreApplication::instance())
+            applyTheme();
+    }
+
+    void GreeterApp::loadTheme()
+    {
         // Read theme metadata
         const QString metadataPath = QStringLiteral("%1/metadata.desktop").arg(m_themePath);
         if (m_metadata)
@@ -123,6 +143,19 @@ namespace SDDM {
         if (!m_userModel)
             m_userModel = new UserModel(themeNeedsAllUsers, nullptr);
 
+        StartupProfiler::instance()->mark(QStringLiteral("theme loaded"));
+    }
+
+    void GreeterApp::applyTheme()
+    {
+        // Translations
+        // Components translation
+        if (!m_components_tranlator) {
+            m_components_tranlator = new QTranslator();
+            if (m_components_tranlator->load(QLocale::system(), QString(), QString(), QStringLiteral(COMPONENTS_TRANSLATION_DIR)))
+                QCoreApplication::installTranslator(m_components_tranlator);
+        }
+
         // Set default icon theme from greeter theme
         if (m_themeConfig->contains(QStringLiteral("iconTheme")))
             QIcon::setThemeName(m_themeConfig->value(QStringLiteral("iconTheme")).toString());
@@ -142,9 +175,102 @@ namespace SDDM {
             startup();
     }
 
+    bool GreeterApp::eventFilter(QObject *watched, QEvent *event)
+    {
+        switch (event->type()) {
+        case QEvent::Expose: {
+            // let the theme stop its timers while the screen can't be seen
+            QQuickView *view = qobject_cast<QQuickView *>(watched);
+            QQmlContext *context = m_viewContexts.value(view);
+            if (context)
+                context->setContextProperty(QStringLiteral("screenActive"), view->isExposed());
+            break;
+        }
+        case QEvent::KeyPress:
+        case QEvent::MouseButtonPress:
+        case QEvent::MouseMove:
+        case QEvent::Wheel:
+        case QEvent::TouchBegin:
+            if (m_idleTimer) {
+                setIdle(false);
+                m_idleTimer->start();
+            }
+            break;
+        default:
+            break;
+        }
+
+        return QObject::eventFilter(watched, event);
+    }
+
+    void GreeterApp::setIdle(bool idle)
+    {
+        // a blinking cursor repaints the view twice a second, stop
+        // it so that nothing is dirty until the next input
+        QStyleHints *hints = QGuiApplication::styleHints();
+        if (idle && m_cursorFlashTime < 0) {
+            m_cursorFlashTime = hints->cursorFlashTime();
+            hints->setCursorFlashTime(0);
+        } else if (!idle && m_cursorFlashTime >= 0) {
+            hints->setCursorFlashTime(m_cursorFlashTime);
+            m_cursorFlashTime = -1;
+        }
+    }
+
+    void GreeterApp::createComponent()
+    {
+        // all views share one engine and one component, so the theme is
+        // compiled once no matter how many screens there are
+        m_engine = new QQmlEngine(this);
+        m_engine->addImportPath(QStringLiteral(IMPORTS_INSTALL_DIR));
+        m_engine->addImageProvider(QStringLiteral("sddm-background"), new BackgroundImageProvider());
+
+        // set context properties shared by all screens
+        QQmlContext *context = m_engine->rootContext();
+        context->setContextProperty(QStringLiteral("sessionModel"), m_sessionModel);
+        context->setContextProperty(QStringLiteral("userModel"), m_userModel);
+        context->setContextProperty(QStringLiteral("config"), *m_themeConfig);
+        context->setContextProperty(QStringLiteral("sddm"), m_proxy);
+        context->setContextProperty(QStringLiteral("keyboard"), m_keyboard);
+        context->setContextProperty(QStringLiteral("__sddm_errors"), QString());
+        context->setContextProperty(QStringLiteral("__sddm_backgrounds"), true);
+
+        // get theme main script
+        QString mainScript = QStringLiteral("%1/%2").arg(m_themePath).arg(m_metadata->mainScript());
+        QUrl mainScriptUrl;
+        if (m_themePath.startsWith(QLatin1String("qrc:/")))
+            mainScriptUrl = QUrl(mainScript);
+        else
+            mainScriptUrl = QUrl::fromLocalFile(mainScript);
+
+        // compile main script
+        qInfo("Loading %s...", qPrintable(mainScriptUrl.toString()));
+        m_component = new QQmlComponent(m_engine, mainScriptUrl, this);
+
+        // load theme from resources when an error has occurred
+        if (m_component->isError())
+            useEmbeddedTheme();
+    }
+
+    void GreeterApp::useEmbeddedTheme()
+    {
+        QString errors;
+        const auto errorList = m_component->errors();
+        for(const QQmlError &e : errorList) {
+            qWarning() << e;
+            errors += QLatin1String("\n") + e.toString();
+        }
+
+        qWarning() << "Fallback to embedded theme";
+        m_engine->rootContext()->setContextProperty(QStringLiteral("__sddm_errors"), errors);
+
+        delete m_component;
+        m_component = new QQmlComponent(m_engine, QUrl(QStringLiteral("qrc:/theme/Main.qml")), this);
+    }
+
     void GreeterApp::addViewForScreen(QScreen *screen) {
         // create view
-        QQuickView *view = new QQuickView();
+        QQuickView *view = new QQuickView(m_engine, nullptr);
         view->setScreen(screen);
         view->setResizeMode(QQuickView::SizeRootObjectToView);
         //view->setGeometry(QRect(QPoint(0, 0), screen->geometry().size()));
@@ -165,8 +291,6 @@ namespace SDDM {
             view->setGeometry(r);
         });
 
-        view->engine()->addImportPath(QStringLiteral(IMPORTS_INSTALL_DIR));
-
         // connect proxy signals
         connect(m_proxy, &GreeterProxy::loginSucceeded, view, &QQuickView::close);
 
@@ -181,48 +305,40 @@ namespace SDDM {
         // in order to avoid creating items with different sizes.
         ScreenModel *screenModel = new ScreenModel(screen, view);
 
-        // set context properties
-        view->rootContext()->setContextProperty(QStringLiteral("sessionModel"), m_sessionModel);
-        view->rootContext()->setContextProperty(QStringLiteral("screenModel"), screenModel);
-        view->rootContext()->setContextProperty(QStringLiteral("userModel"), m_userModel);
-        view->rootContext()->setContextProperty(QStringLiteral("config"), *m_themeConfig);
-        view->rootContext()->setContextProperty(QStringLiteral("sddm"), m_proxy);
-        view->rootContext()->setContextProperty(QStringLiteral("keyboard"), m_keyboard);
-        view->rootContext()->setContextProperty(QStringLiteral("primaryScreen"), QGuiApplication::primaryScreen() == screen);
-        view->rootContext()->setContextProperty(QStringLiteral("__sddm_errors"), QString());
-
-        // get theme main script
-        QString mainScript = QStringLiteral("%1/%2").arg(m_themePath).arg(m_metadata->mainScript());
-        QUrl mainScriptUrl;
-        if (m_themePath.startsWith(QLatin1String("qrc:/")))
-            mainScriptUrl = QUrl(mainScript);
-        else
-            mainScriptUrl = QUrl::fromLocalFile(mainScript);
-
-        // load theme from resources when an error has occurred
-        connect(view, &QQuickView::statusChanged, this, [view](QQuickView::Status status) {
-            if (status != QQuickView::Error)
-                return;
-
-            QString errors;
-            const auto errorList = view->errors();
-            for(const QQmlError &e : errorList) {
-                qWarning() << e;
-                errors += QLatin1String("\n") + e.toString();
-            }
-
-            qWarning() << "Fallback to embedded theme";
-            view->rootContext()->setContextProperty(QStringLiteral("__sddm_errors"), errors);
-            view->setSource(QUrl(QStringLiteral("qrc:/theme/Main.qml")));
-        });
-
-        // set main script as source
-        qInfo("Loading %s...", qPrintable(mainScriptUrl.toString()));
-        view->setSource(mainScriptUrl);
+        // set context properties specific to this screen
+        QQmlContext *context = new QQmlContext(m_engine->rootContext(), view);
+        context->setContextProperty(QStringLiteral("screenModel"), screenModel);
+        context->setContextProperty(QStringLiteral("primaryScreen"), QGuiApplication::primaryScreen() == screen);
+        context->setContextProperty(QStringLiteral("screenActive"), false);
+        m_viewContexts.insert(view, context);
+        view->installEventFilter(this);
+
+        // instantiate the theme for this screen
+        QObject *object = m_component->create(context);
+        if (!object && m_component->url() != QUrl(QStringLiteral("qrc:/theme/Main.qml"))) {
+            useEmbeddedTheme();
+            object = m_component->create(context);
+        }
+        view->setContent(m_component->url(), m_component, object);
+        StartupProfiler::instance()->mark(QStringLiteral("view created %1").arg(screen->name()));
+
+        // the startup is over once every initial view has been drawn
+        if (m_pendingFrames >= 0) {
+            ++m_pendingFrames;
+            const QString name = screen->name();
+            auto connection = std::make_shared<QMetaObject::Connection>();
+            *connection = connect(view, &QQuickWindow::frameSwapped, this, [this, connection, name]() {
+                QObject::disconnect(*connection);
+                StartupProfiler::instance()->mark(QStringLiteral("first frame %1").arg(name));
+                if (--m_pendingFrames == 0)
+                    reportStartup();
+            });
+        }
 
         // set default cursor
         QCursor cursor(Qt::ArrowCursor);
-        view->rootObject()->setCursor(cursor);
+        if (view->rootObject())
+            view->rootObject()->setCursor(cursor);
 
         // show
         qDebug() << "Adding view for" << screen->name() << screen->geometry();
@@ -236,11 +352,17 @@ namespace SDDM {
     void GreeterApp::removeViewForScreen(QQuickView *view) {
         // screen is gone, remove the window
         m_views.removeOne(view);
+        m_viewContexts.remove(view);
         view->deleteLater();
     }
 
     void GreeterApp::startup()
     {
+        // Create models
+        m_sessionModel = new SessionModel();
+        m_keyboard = new KeyboardModel();
+        StartupProfiler::instance()->mark(QStringLiteral("models created"));
+
         // Connect to the daemon
         m_proxy = new GreeterProxy(m_socket);
         if (!m_testing && !m_proxy->isConnected()) {
@@ -248,6 +370,7 @@ namespace SDDM {
             QCoreApplication::exit(EXIT_FAILURE);
             return;
         }
+        StartupProfiler::instance()->mark(QStringLiteral("connected"));
 
         // Set numlock upon start
         if (m_keyboard->enabled()) {
@@ -269,11 +392,28 @@ namespace SDDM {
         // Set session model on proxy
         m_proxy->setSessionModel(m_sessionModel);
 
+        // Compile the theme
+        createComponent();
+        StartupProfiler::instance()->mark(QStringLiteral("theme compiled"));
+
         // Create views
         const QList<QScreen *> screens = qGuiApp->primaryScreen()->virtualSiblings();
         for (QScreen *screen : screens)
             addViewForScreen(screen);
 
+        // Go idle after a while without input
+        const int idleTimeout = mainConfig.Theme.IdleTimeout.get();
+        if (idleTimeout > 0) {
+            m_idleTimer = new QTimer(this);
+            m_idleTimer->setSingleShot(true);
+            m_idleTimer->setInterval(idleTimeout * 1000);
+            connect(m_idleTimer, &QTimer::timeout, this, [this]() {
+                setIdle(true);
+            });
+            m_idleTimer->start();
+            qGuiApp->installEventFilter(this);
+        }
+
         // Handle screens
         connect(qGuiApp, &QGuiApplication::screenAdded, this, &GreeterApp::addViewForScreen);
         connect(qGuiApp, &QGuiApplication::primaryScreenChanged, this, [this](QScreen *) {
@@ -281,6 +421,21 @@ namespace SDDM {
         });
     }
 
+    void GreeterApp::reportStartup()
+    {
+        // views added later on don't count
+        m_pendingFrames = -1;
+
+        const StartupProfiler *profiler = StartupProfiler::instance();
+        if (m_proxy->isConnected())
+            m_proxy->sendStartupTimings(profiler->timings());
+
+        // dump as JSON to compare themes offline
+        const QString fileName = QString::fromLocal8Bit(qgetenv("SDDM_STARTUP_TIMINGS"));
+        if (!fileName.isEmpty())
+            profiler->dump(fileName, m_themePath);
+    }
+
     void GreeterApp::activatePrimary() {
         // activate and give focus to the window assigned to the primary screen
         for (QQuickView *view : qAsConst(m_views)) {
@@ -295,12 +450,83 @@ namespace SDDM {
         : QEvent(StartupEventType)
     {
     }
+
+    // Blocks until the daemon tells us the display server is ready and
+    // returns the display name, or an empty string if the daemon went
+    // away. There is no event loop yet, so the socket is used directly.
+    static QString waitForDisplay(const QString &socketPath)
+    {
+        const QByteArray path = QFile::encodeName(socketPath);
+
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= int(sizeof(addr.sun_path))) {
+            qCritical() << "Socket path is too long:" << socketPath;
+            return QString();
+        }
+        memcpy(addr.sun_path, path.constData(), path.size());
+
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd == -1 || ::connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) == -1) {
+            qCritical() << "Cannot connect to the daemon:" << strerror(errno);
+            if (fd != -1)
+                close(fd);
+            return QString();
+        }
+
+        // ask to be told when the display is ready
+        QByteArray request;
+        QDataStream output(&request, QIODevice::WriteOnly);
+        output.setVersion(ProtocolStreamVersion);
+        output << quint32(GreeterMessages::WaitForDisplay);
+        request = SocketWriter::frame(request);
+        if (write(fd, request.constData(), request.size()) != request.size()) {
+            qCritical() << "Cannot send request to the daemon:" << strerror(errno);
+            close(fd);
+            return QString();
+        }
+
+        // read until the reply is complete
+        SocketReader reader;
+        QByteArray reply;
+        QString displayName;
+        char buffer[256];
+        forever {
+            ssize_t count = read(fd, buffer, sizeof(buffer));
+            if (count == -1 && errno == EINTR)
+                continue;
+            if (count <= 0)
+                break;
+            reader.append(QByteArray(buffer, int(count)));
+
+            if (reader.next(reply)) {
+                QDataStream input(reply);
+                input.setVersion(ProtocolStreamVersion);
+                quint32 message;
+                QString name;
+                input >> message >> name;
+                if (DaemonMessages(message) == DaemonMessages::DisplayReady)
+                    displayName = name;
+                break;
+            }
+            if (reader.hasError())
+                break;
+        }
+
+        close(fd);
+        return displayName;
+    }
 }
 
 int main(int argc, char **argv)
 {
     // Install message handler
     qInstallMessageHandler(SDDM::GreeterMessageHandler);
+    SDDM::setLogRules(SDDM::mainConfig.LogRules.get());
+
+    // Start the clock for the startup timings
+    SDDM::StartupProfiler::instance();
 
     // We set an attribute based on the platform we run on.
     // We only know the platform after we constructed QGuiApplication
@@ -318,6 +544,34 @@ int main(int argc, char **argv)
         platform = QStringLiteral("xcb");
     }
 
+    // In prepare mode we are started while the display server is still
+    // starting up. Read the theme and the users now, then wait for the
+    // daemon before QGuiApplication connects to the display.
+    bool prepare = false;
+    QString socketName, themePath;
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--prepare") == 0)
+            prepare = true;
+        else if (qstrcmp(argv[i], "--socket") == 0 && i + 1 < argc)
+            socketName = QString::fromLocal8Bit(argv[i + 1]);
+        else if (qstrcmp(argv[i], "--theme") == 0 && i + 1 < argc)
+            themePath = QString::fromLocal8Bit(argv[i + 1]);
+    }
+
+    SDDM::GreeterApp *greeter = new SDDM::GreeterApp();
+    if (prepare) {
+        greeter->setThemePath(themePath);
+
+        const QString displayName = SDDM::waitForDisplay(socketName);
+        if (displayName.isEmpty()) {
+            qCritical() << "Display server did not start";
+            return EXIT_FAILURE;
+        }
+        qDebug() << "Display" << displayName << "is ready";
+        SDDM::StartupProfiler::instance()->mark(QStringLiteral("display ready"));
+        qputenv("DISPLAY", displayName.toLocal8Bit());
+    }
+
     // HiDPI
     bool hiDpiEnabled = false;
     if (platform == QStringLiteral("xcb"))
@@ -353,9 +607,11 @@ int main(int argc, char **argv)
     QCommandLineOption themeOption(QLatin1String("theme"), TR("Greeter theme"), TR("path"));
     parser.addOption(themeOption);
 
+    QCommandLineOption prepareOption(QLatin1String("prepare"), TR("Wait for the daemon to report the display server as ready"));
+    parser.addOption(prepareOption);
+
     parser.process(app);
 
-    SDDM::GreeterApp *greeter = new SDDM::GreeterApp();
     greeter->setTestModeEnabled(parser.isSet(testModeOption));
     greeter->setSocketName(parser.value(socketOption));
     greeter->setThemePath(parser.value(themeOption));
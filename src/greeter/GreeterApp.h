@@ -21,10 +21,15 @@
 #ifndef GREETERAPP_H
 #define GREETERAPP_H
 
+#include <QHash>
 #include <QObject>
 #include <QScreen>
 #include <QQuickView>
 
+class QQmlComponent;
+class QQmlContext;
+class QQmlEngine;
+class QTimer;
 class QTranslator;
 
 namespace SDDM {
@@ -56,6 +61,7 @@ namespace SDDM {
 
     protected:
         void customEvent(QEvent *event) override;
+        bool eventFilter(QObject *watched, QEvent *event) override;
 
     private slots:
         void addViewForScreen(QScreen *screen);
@@ -67,6 +73,9 @@ namespace SDDM {
         QString m_themePath;
 
         QList<QQuickView *> m_views;
+        QHash<QQuickView *, QQmlContext *> m_viewContexts;
+        QQmlEngine *m_engine { nullptr };
+        QQmlComponent *m_component { nullptr };
         QTranslator *m_theme_translator { nullptr },
                     *m_components_tranlator { nullptr };
 
@@ -77,8 +86,19 @@ namespace SDDM {
         GreeterProxy *m_proxy { nullptr };
         KeyboardModel *m_keyboard { nullptr };
 
+        int m_pendingFrames { 0 };
+
+        QTimer *m_idleTimer { nullptr };
+        int m_cursorFlashTime { -1 };
+
+        void loadTheme();
+        void applyTheme();
+        void createComponent();
+        void useEmbeddedTheme();
         void startup();
         void activatePrimary();
+        void reportStartup();
+        void setIdle(bool idle);
     };
 
     class StartupEvent : public QEvent
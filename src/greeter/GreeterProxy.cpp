@@ -21,10 +21,13 @@
 #include "GreeterProxy.h"
 
 #include "Configuration.h"
+#include "LogCategories.h"
 #include "Messages.h"
 #include "SessionModel.h"
+#include "SocketReader.h"
 #include "SocketWriter.h"
 
+#include <QFileInfo>
 #include <QLocalSocket>
 
 namespace SDDM {
@@ -32,6 +35,7 @@ namespace SDDM {
     public:
         SessionModel *sessionModel { nullptr };
         QLocalSocket *socket { nullptr };
+        SocketReader reader;
         QString hostName;
         bool canPowerOff { false };
         bool canReboot { false };
@@ -108,10 +112,23 @@ namespace SDDM {
         SocketWriter(d->socket) << quint32(GreeterMessages::HybridSleep);
     }
 
+    void GreeterProxy::prepareLogin(const QString &user, const int sessionIndex) const {
+        if (!d->sessionModel || user.isEmpty())
+            return;
+
+        // get model index
+        QModelIndex index = d->sessionModel->index(sessionIndex, 0);
+
+        // let the daemon start authenticating before the password is in
+        quint32 type = d->sessionModel->data(index, SessionModel::TypeRole).toUInt();
+        QString name = QFileInfo(d->sessionModel->data(index, SessionModel::FileRole).toString()).fileName();
+        SocketWriter(d->socket) << quint32(GreeterMessages::PrepareLogin) << user << type << name;
+    }
+
     void GreeterProxy::login(const QString &user, const QString &password, const int sessionIndex) const {
         if (!d->sessionModel) {
             // log error
-            qCritical() << "Session model is not set.";
+            qCCritical(lcSocket) << "Session model is not set.";
 
             // return
             return;
@@ -120,43 +137,73 @@ namespace SDDM {
         // get model index
         QModelIndex index = d->sessionModel->index(sessionIndex, 0);
 
-        // send command to the daemon
-        Session::Type type = static_cast<Session::Type>(d->sessionModel->data(index, SessionModel::TypeRole).toInt());
-        QString name = d->sessionModel->data(index, SessionModel::FileRole).toString();
-        Session session(type, name);
-        SocketWriter(d->socket) << quint32(GreeterMessages::Login) << user << password << session;
+        // send command to the daemon, the session is identified by its type
+        // and file name only, the daemon resolves it against its own index
+        quint32 type = d->sessionModel->data(index, SessionModel::TypeRole).toUInt();
+        QString name = QFileInfo(d->sessionModel->data(index, SessionModel::FileRole).toString()).fileName();
+        SocketWriter(d->socket) << quint32(GreeterMessages::Login) << user << password << type << name;
+    }
+
+    void GreeterProxy::sendStartupTimings(const StartupTimings &timings) {
+        SocketWriter writer(d->socket);
+        writer << quint32(GreeterMessages::StartupTimings) << quint32(timings.size());
+        for (const auto &timing : timings)
+            writer << timing.first << timing.second;
     }
 
     void GreeterProxy::connected() {
         // log connection
-        qDebug() << "Connected to the daemon.";
+        qCDebug(lcSocket) << "Connected to the daemon.";
 
-        // send connected message
-        SocketWriter(d->socket) << quint32(GreeterMessages::Connect);
+        // send connected message along with the protocol we speak
+        SocketWriter(d->socket) << quint32(GreeterMessages::Connect) << ProtocolVersion;
     }
 
     void GreeterProxy::disconnected() {
         // log disconnection
-        qDebug() << "Disconnected from the daemon.";
+        qCDebug(lcSocket) << "Disconnected from the daemon.";
     }
 
     void GreeterProxy::error() {
-        qCritical() << "Socket error: " << d->socket->errorString();
+        qCCritical(lcSocket) << "Socket error: " << d->socket->errorString();
     }
 
     void GreeterProxy::readyRead() {
-        // input stream
-        QDataStream input(d->socket);
+        // messages may arrive split or several at once
+        d->reader.append(d->socket->readAll());
+
+        QByteArray data;
+        while (d->reader.next(data)) {
+            // input stream
+            QDataStream input(data);
+            input.setVersion(ProtocolStreamVersion);
 
-        while (input.device()->bytesAvailable()) {
             // read message
             quint32 message;
             input >> message;
 
             switch (DaemonMessages(message)) {
+                case DaemonMessages::Welcome:
+                case DaemonMessages::Version: {
+                    // read the version both sides speak
+                    quint32 version;
+                    input >> version;
+
+                    // log message
+                    qCDebug(lcSocket) << "Message received from daemon: protocol version" << version;
+
+                    // from version 2 on the capabilities come along
+                    if (DaemonMessages(message) == DaemonMessages::Version)
+                        break;
+                    if (data.size() != int(sizeof(quint32)) + WelcomeSize) {
+                        qCWarning(lcSocket) << "Malformed Welcome message from daemon, skipped.";
+                        break;
+                    }
+                }
+                // fall through
                 case DaemonMessages::Capabilities: {
                     // log message
-                    qDebug() << "Message received from daemon: Capabilities";
+                    qCDebug(lcSocket) << "Message received from daemon: Capabilities";
 
                     // read capabilities
                     quint32 capabilities;
@@ -179,7 +226,7 @@ namespace SDDM {
                 break;
                 case DaemonMessages::HostName: {
                     // log message
-                    qDebug() << "Message received from daemon: HostName";
+                    qCDebug(lcSocket) << "Message received from daemon: HostName";
 
                     // read host name
                     input >> d->hostName;
@@ -190,7 +237,7 @@ namespace SDDM {
                 break;
                 case DaemonMessages::LoginSucceeded: {
                     // log message
-                    qDebug() << "Message received from daemon: LoginSucceeded";
+                    qCDebug(lcSocket) << "Message received from daemon: LoginSucceeded";
 
                     // emit signal
                     emit loginSucceeded();
@@ -198,7 +245,7 @@ namespace SDDM {
                 break;
                 case DaemonMessages::LoginFailed: {
                     // log message
-                    qDebug() << "Message received from daemon: LoginFailed";
+                    qCDebug(lcSocket) << "Message received from daemon: LoginFailed";
 
                     // emit signal
                     emit loginFailed();
@@ -206,9 +253,18 @@ namespace SDDM {
                 break;
                 default: {
                     // log message
-                    qWarning() << "Unknown message received from daemon.";
+                    qCWarning(lcSocket) << "Unknown message received from daemon, skipped.";
                 }
             }
         }
+
+        if (d->reader.hasError()) {
+            // log message
+            qCCritical(lcSocket) << "Malformed message received from daemon.";
+
+            // drop the connection
+            d->reader.clear();
+            d->socket->abort();
+        }
     }
 }
@@ -22,6 +22,8 @@
 
 #include <QObject>
 
+#include "StartupProfiler.h"
+
 class QLocalSocket;
 
 namespace SDDM {
@@ -55,6 +57,8 @@ namespace SDDM {
 
         void setSessionModel(SessionModel *model);
 
+        void sendStartupTimings(const StartupTimings &timings);
+
     public slots:
         void powerOff();
         void reboot();
@@ -62,6 +66,7 @@ namespace SDDM {
         void hibernate();
         void hybridSleep();
 
+        void prepareLogin(const QString &user, const int sessionIndex) const;
         void login(const QString &user, const QString &password, const int sessionIndex) const;
 
     private slots:
@@ -0,0 +1,100 @@
+/***************************************************************************
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#include "StartupProfiler.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <time.h>
+#include <unistd.h>
+
+namespace SDDM {
+    // milliseconds between the start of this process and now, taken
+    // from the start time the kernel keeps in /proc/self/stat
+    static qint64 processAge() {
+        QFile file(QStringLiteral("/proc/self/stat"));
+        if (!file.open(QIODevice::ReadOnly))
+            return 0;
+
+        // the command name may contain spaces, skip past it
+        const QByteArray stat = file.readAll();
+        const QList<QByteArray> fields = stat.mid(stat.lastIndexOf(')') + 2).split(' ');
+
+        // starttime is field 22, the list starts at field 3
+        if (fields.size() < 20)
+            return 0;
+        const qint64 startTicks = fields.at(19).toLongLong();
+
+        struct timespec now;
+        if (clock_gettime(CLOCK_BOOTTIME, &now) == -1)
+            return 0;
+
+        const qint64 nowMsecs = qint64(now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+        const qint64 startMsecs = startTicks * 1000 / sysconf(_SC_CLK_TCK);
+        return qMax(Q_INT64_C(0), nowMsecs - startMsecs);
+    }
+
+    StartupProfiler::StartupProfiler() {
+        m_timer.start();
+        m_offset = processAge();
+
+        m_timings << qMakePair(QStringLiteral("process start"), quint32(0));
+        m_timings << qMakePair(QStringLiteral("main"), quint32(m_offset));
+    }
+
+    StartupProfiler *StartupProfiler::instance() {
+        static StartupProfiler profiler;
+        return &profiler;
+    }
+
+    void StartupProfiler::mark(const QString &name) {
+        const quint32 msecs = quint32(m_offset + m_timer.elapsed());
+        m_timings << qMakePair(name, msecs);
+        qDebug() << "Startup:" << name << "after" << msecs << "ms";
+    }
+
+    const StartupTimings &StartupProfiler::timings() const {
+        return m_timings;
+    }
+
+    bool StartupProfiler::dump(const QString &fileName, const QString &theme) const {
+        QJsonArray timings;
+        for (const auto &timing : m_timings) {
+            QJsonObject entry;
+            entry.insert(QStringLiteral("name"), timing.first);
+            entry.insert(QStringLiteral("msecs"), qint64(timing.second));
+            timings.append(entry);
+        }
+
+        QJsonObject root;
+        root.insert(QStringLiteral("theme"), theme);
+        root.insert(QStringLiteral("timings"), timings);
+
+        QFile file(fileName);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            qWarning() << "Failed to write startup timings to" << fileName;
+            return false;
+        }
+        file.write(QJsonDocument(root).toJson());
+        return true;
+    }
+}
@@ -0,0 +1,53 @@
+/***************************************************************************
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+#ifndef SDDM_STARTUPPROFILER_H
+#define SDDM_STARTUPPROFILER_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QPair>
+#include <QString>
+
+namespace SDDM {
+    typedef QList<QPair<QString, quint32>> StartupTimings;
+
+    /**
+     * Records when the greeter reaches the steps of its startup,
+     * in milliseconds since the process was started.
+     */
+    class StartupProfiler {
+        Q_DISABLE_COPY(StartupProfiler)
+    public:
+        static StartupProfiler *instance();
+
+        void mark(const QString &name);
+        const StartupTimings &timings() const;
+
+        bool dump(const QString &fileName, const QString &theme) const;
+
+    private:
+        StartupProfiler();
+
+        QElapsedTimer m_timer;
+        qint64 m_offset { 0 };
+        StartupTimings m_timings;
+    };
+}
+
+#endif // SDDM_STARTUPPROFILER_H
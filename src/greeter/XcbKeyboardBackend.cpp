@@ -19,15 +19,26 @@
 
 #include <QtCore/QDebug>
 #include <QtCore/QObject>
+#include <QtGui/QGuiApplication>
+
+#include <qpa/qplatformnativeinterface.h>
 
 #include "KeyboardModel.h"
+
 #include "KeyboardModel_p.h"
 #include "KeyboardLayout.h"
 #include "XcbKeyboardBackend.h"
+#include "LogCategories.h"
 
 #include <QSocketNotifier>
+#include <QTimer>
+
+#include <string.h>
 
 namespace SDDM {
+    // How often to check for layout names after a change, in ms
+    static const int LayoutsPollInterval = 20;
+
     XcbKeyboardBackend::XcbKeyboardBackend(KeyboardModelPrivate *kmp) : KeyboardBackend(kmp) {
     }
 
@@ -36,17 +47,110 @@ namespace SDDM {
 
     void XcbKeyboardBackend::init() {
         connectToDisplay();
-        if (d->enabled)
-            initLedMap();
-        if (d->enabled)
-            initLayouts();
-        if (d->enabled)
-            initState();
+        if (!d->enabled)
+            return;
+
+        // Issue every request up front, the server answers them in order
+        // and we only wait once for the whole batch
+        xcb_prefetch_extension_data(m_conn, &xcb_xkb_id);
+
+        xcb_xkb_use_extension_cookie_t extCookie =
+                xcb_xkb_use_extension(m_conn, XCB_XKB_MAJOR_VERSION, XCB_XKB_MINOR_VERSION);
+        xcb_intern_atom_cookie_t numCookie =
+                xcb_intern_atom(m_conn, 1, 8, "Num Lock");
+        xcb_intern_atom_cookie_t capsCookie =
+                xcb_intern_atom(m_conn, 1, 9, "Caps Lock");
+        xcb_xkb_get_names_cookie_t namesCookie =
+                xcb_xkb_get_names(m_conn, XCB_XKB_ID_USE_CORE_KBD,
+                                  XCB_XKB_NAME_DETAIL_INDICATOR_NAMES |
+                                  XCB_XKB_NAME_DETAIL_GROUP_NAMES |
+                                  XCB_XKB_NAME_DETAIL_SYMBOLS);
+        xcb_xkb_get_indicator_map_cookie_t mapCookie =
+                xcb_xkb_get_indicator_map(m_conn, XCB_XKB_ID_USE_CORE_KBD, 0xffffffff);
+        xcb_xkb_get_state_cookie_t stateCookie =
+                xcb_xkb_get_state(m_conn, XCB_XKB_ID_USE_CORE_KBD);
+        xcb_flush(m_conn);
+
+        // Collect replies
+        xcb_generic_error_t *error = nullptr;
+        xcb_xkb_use_extension_reply_t *extReply =
+                xcb_xkb_use_extension_reply(m_conn, extCookie, &error);
+        xcb_intern_atom_reply_t *numReply = xcb_intern_atom_reply(m_conn, numCookie, nullptr);
+        xcb_intern_atom_reply_t *capsReply = xcb_intern_atom_reply(m_conn, capsCookie, nullptr);
+
+        if (error != nullptr || extReply == nullptr || !extReply->supported) {
+            qCCritical(lcGreeterModels) << "xcb_xkb_use_extension failed, extension disabled, error code"
+                        << (error ? error->error_code : 0);
+            d->enabled = false;
+            free(error);
+            error = nullptr;
+        }
+
+        xcb_xkb_get_names_reply_t *namesReply =
+                xcb_xkb_get_names_reply(m_conn, namesCookie, &error);
+        if (error) {
+            if (d->enabled)
+                qCCritical(lcGreeterModels) << "Can't init led map and layouts: " << error->error_code;
+            d->enabled = false;
+            free(error);
+            error = nullptr;
+        }
+
+        xcb_xkb_get_indicator_map_reply_t *mapReply =
+                xcb_xkb_get_indicator_map_reply(m_conn, mapCookie, &error);
+        if (error) {
+            qCWarning(lcGreeterModels) << "Can't get indicator masks " << error->error_code;
+            free(error);
+            error = nullptr;
+        }
+
+        xcb_xkb_get_state_reply_t *stateReply =
+                xcb_xkb_get_state_reply(m_conn, stateCookie, &error);
+        if (error) {
+            if (d->enabled)
+                qCCritical(lcGreeterModels) << "Can't load leds state - " << error->error_code;
+            d->enabled = false;
+            free(error);
+            error = nullptr;
+        }
+
+        if (d->enabled) {
+            // Already cached by the prefetch above
+            const xcb_query_extension_reply_t *data = xcb_get_extension_data(m_conn, &xcb_xkb_id);
+            if (data)
+                m_firstEvent = data->first_event;
+
+            initLedMap(namesReply, mapReply,
+                       numReply ? numReply->atom : XCB_ATOM_NONE,
+                       capsReply ? capsReply->atom : XCB_ATOM_NONE);
+
+            // Resolve the layout names, batched as well
+            QStringList layoutNames;
+            for (const xcb_get_atom_name_cookie_t &cookie : requestAtomNames(namesReply))
+                layoutNames << atomName(cookie);
+            setLayouts(layoutNames);
+            initState(stateReply);
+        }
+
+        // Free
+        free(extReply);
+        free(numReply);
+        free(capsReply);
+        free(namesReply);
+        free(mapReply);
+        free(stateReply);
     }
 
     void XcbKeyboardBackend::disconnect() {
         delete m_socket;
-        xcb_disconnect(m_conn);
+        m_socket = nullptr;
+
+        if (m_ownsConnection) {
+            xcb_disconnect(m_conn);
+        } else if (qApp) {
+            qApp->removeNativeEventFilter(this);
+        }
+        m_conn = nullptr;
     }
 
     void XcbKeyboardBackend::sendChanges() {
@@ -69,153 +173,197 @@ namespace SDDM {
         error = xcb_request_check(m_conn, cookie);
 
         if (error) {
-            qWarning() << "Can't update state: " << error->error_code;
+            qCWarning(lcGreeterModels) << "Can't update state: " << error->error_code;
         }
     }
 
     void XcbKeyboardBackend::connectToDisplay() {
-        // Connect and initialize xkb extension
-        xcb_xkb_use_extension_cookie_t cookie;
-        xcb_generic_error_t *error = nullptr;
+        // Reuse the connection Qt already opened when running on xcb, so the
+        // keyboard setup doesn't pay for a second connection handshake
+        if (QGuiApplication::platformName() == QLatin1String("xcb")) {
+            QPlatformNativeInterface *native = QGuiApplication::platformNativeInterface();
+            if (native)
+                m_conn = reinterpret_cast<xcb_connection_t *>(
+                            native->nativeResourceForIntegration(QByteArrayLiteral("connection")));
+        }
 
-        m_conn = xcb_connect(nullptr, nullptr);
-        if (m_conn == nullptr) {
-            qCritical() << "xcb_connect failed, keyboard extension disabled";
-            d->enabled = false;
+        if (m_conn != nullptr) {
+            m_ownsConnection = false;
             return;
         }
 
-        // Initialize xkb extension
-        cookie = xcb_xkb_use_extension(m_conn, XCB_XKB_MAJOR_VERSION, XCB_XKB_MINOR_VERSION);
-        xcb_xkb_use_extension_reply(m_conn, cookie, &error);
-
-        if (error != nullptr) {
-            qCritical() << "xcb_xkb_use_extension failed, extension disabled, error code"
-                        << error->error_code;
+        m_conn = xcb_connect(nullptr, nullptr);
+        m_ownsConnection = true;
+        if (xcb_connection_has_error(m_conn)) {
+            qCCritical(lcGreeterModels) << "xcb_connect failed, keyboard extension disabled";
+            xcb_disconnect(m_conn);
+            m_conn = nullptr;
+            m_ownsConnection = false;
             d->enabled = false;
-            return;
         }
     }
 
-    void XcbKeyboardBackend::initLedMap() {
-        // Get indicator names atoms
-        xcb_xkb_get_names_cookie_t cookie;
-        xcb_xkb_get_names_reply_t *reply = nullptr;
-        xcb_generic_error_t *error = nullptr;
-
-        cookie = xcb_xkb_get_names(m_conn,
-                XCB_XKB_ID_USE_CORE_KBD,
-                XCB_XKB_NAME_DETAIL_INDICATOR_NAMES);
-        reply = xcb_xkb_get_names_reply(m_conn, cookie, &error);
-
-        if (error) {
-            qCritical() << "Can't init led map: " << error->error_code;
-            d->enabled = false;
+    void XcbKeyboardBackend::initLedMap(xcb_xkb_get_names_reply_t *names,
+                                        xcb_xkb_get_indicator_map_reply_t *maps,
+                                        xcb_atom_t numLock, xcb_atom_t capsLock) {
+        if (!names || !maps)
             return;
-        }
 
         // Unpack
         xcb_xkb_get_names_value_list_t list;
-        const void *buffer = xcb_xkb_get_names_value_list(reply);
-        xcb_xkb_get_names_value_list_unpack(buffer, reply->nTypes, reply->indicators,
-                reply->virtualMods, reply->groupNames, reply->nKeys, reply->nKeyAliases,
-                reply->nRadioGroups, reply->which, &list);
-
-        // Get indicators count
-        int ind_cnt = xcb_xkb_get_names_value_list_indicator_names_length(reply, &list);
-
-        // Loop through indicators and get their properties
-        QList<xcb_get_atom_name_cookie_t> cookies;
-        for (int i = 0; i < ind_cnt; i++) {
-            cookies << xcb_get_atom_name(m_conn, list.indicatorNames[i]);
-        }
-
-        for (int i = 0; i < ind_cnt; i++) {
-            QString name = atomName(cookies[i]);
-
-            if (name == QLatin1String("Num Lock")) {
-                d->numlock.mask = getIndicatorMask(i);
-            } else if (name == QLatin1String("Caps Lock")) {
-                d->capslock.mask = getIndicatorMask(i);
+        const void *buffer = xcb_xkb_get_names_value_list(names);
+        xcb_xkb_get_names_value_list_unpack(buffer, names->nTypes, names->indicators,
+                names->virtualMods, names->groupNames, names->nKeys, names->nKeyAliases,
+                names->nRadioGroups, names->which, &list);
+
+        // Indicator names are only reported for bits set in names->indicators
+        // and maps are only reported for bits set in maps->which, both in bit order
+        int ind_cnt = xcb_xkb_get_names_value_list_indicator_names_length(names, &list);
+        xcb_xkb_indicator_map_t *map = xcb_xkb_get_indicator_map_maps(maps);
+        int map_cnt = xcb_xkb_get_indicator_map_maps_length(maps);
+
+        int name_idx = 0, map_idx = 0;
+        for (int bit = 0; bit < 32 && name_idx < ind_cnt; bit++) {
+            bool hasName = names->indicators & (1u << bit);
+            bool hasMap = maps->which & (1u << bit);
+
+            if (hasName && hasMap && map_idx < map_cnt) {
+                xcb_atom_t name = list.indicatorNames[name_idx];
+
+                if (name != XCB_ATOM_NONE && name == numLock)
+                    d->numlock.mask = map[map_idx].mods;
+                else if (name != XCB_ATOM_NONE && name == capsLock)
+                    d->capslock.mask = map[map_idx].mods;
             }
-        }
 
-        // Free memory
-        free(reply);
+            if (hasName)
+                name_idx++;
+            if (hasMap)
+                map_idx++;
+        }
     }
 
-    void XcbKeyboardBackend::initLayouts() {
-        xcb_xkb_get_names_cookie_t cookie;
-        xcb_xkb_get_names_reply_t *reply = nullptr;
-        xcb_generic_error_t *error = nullptr;
-
-        // Get atoms for short and long names
-        cookie = xcb_xkb_get_names(m_conn,
-                XCB_XKB_ID_USE_CORE_KBD,
-                XCB_XKB_NAME_DETAIL_GROUP_NAMES | XCB_XKB_NAME_DETAIL_SYMBOLS);
-        reply = xcb_xkb_get_names_reply(m_conn, cookie, nullptr);
-
-        if (error) {
-            // Log and disable
-            qCritical() << "Can't init layouts: " << error->error_code;
-            return;
-        }
+    QList<xcb_get_atom_name_cookie_t> XcbKeyboardBackend::requestAtomNames(xcb_xkb_get_names_reply_t *names) {
+        if (!names)
+            return QList<xcb_get_atom_name_cookie_t>();
 
         // Unpack
-        const void *buffer = xcb_xkb_get_names_value_list(reply);
+        const void *buffer = xcb_xkb_get_names_value_list(names);
         xcb_xkb_get_names_value_list_t res_list;
-        xcb_xkb_get_names_value_list_unpack(buffer, reply->nTypes, reply->indicators,
-                reply->virtualMods, reply->groupNames, reply->nKeys, reply->nKeyAliases,
-                reply->nRadioGroups, reply->which, &res_list);
-
-        // Get short names
-        QList<QString> short_names = parseShortNames(atomName(res_list.symbolsName));
+        xcb_xkb_get_names_value_list_unpack(buffer, names->nTypes, names->indicators,
+                names->virtualMods, names->groupNames, names->nKeys, names->nKeyAliases,
+                names->nRadioGroups, names->which, &res_list);
 
-        // Loop through group names
-        d->layouts.clear();
-        int groups_cnt = xcb_xkb_get_names_value_list_groups_length(reply, &res_list);
+        // Ask for the symbols and every group name at once
+        int groups_cnt = xcb_xkb_get_names_value_list_groups_length(names, &res_list);
 
         QList<xcb_get_atom_name_cookie_t> cookies;
+        cookies << xcb_get_atom_name(m_conn, res_list.symbolsName);
         for (int i = 0; i < groups_cnt; i++) {
             cookies << xcb_get_atom_name(m_conn, res_list.groups[i]);
         }
+        return cookies;
+    }
 
-        for (int i = 0; i < groups_cnt; i++) {
-            QString nshort, nlong = atomName(cookies[i]);
-            if (i < short_names.length())
-                nshort = short_names[i];
+    void XcbKeyboardBackend::setLayouts(const QStringList &names) {
+        if (names.isEmpty())
+            return;
+
+        // Get short names
+        QList<QString> short_names = parseShortNames(names.first());
+
+        // Loop through group names
+        d->layouts.clear();
+        for (int i = 1; i < names.length(); i++) {
+            QString nshort, nlong = names[i];
+            if (i - 1 < short_names.length())
+                nshort = short_names[i - 1];
 
             d->layouts << new KeyboardLayout(nshort, nlong);
         }
-
-        // Free
-        free(reply);
     }
 
-    void XcbKeyboardBackend::initState() {
-        xcb_xkb_get_state_cookie_t cookie;
-        xcb_xkb_get_state_reply_t *reply = nullptr;
-        xcb_generic_error_t *error = nullptr;
+    void XcbKeyboardBackend::requestLayouts() {
+        // A query is already in flight, redo it once it lands
+        if (m_namesRequest != 0 || !m_atomRequests.isEmpty()) {
+            m_namesStale = true;
+            return;
+        }
 
-        // Get xkb state
-        cookie = xcb_xkb_get_state(m_conn, XCB_XKB_ID_USE_CORE_KBD);
-        reply = xcb_xkb_get_state_reply(m_conn, cookie, &error);
+        // Don't wait for the reply, pollLayouts() picks it up later
+        m_namesRequest = xcb_xkb_get_names(m_conn,
+                XCB_XKB_ID_USE_CORE_KBD,
+                XCB_XKB_NAME_DETAIL_GROUP_NAMES | XCB_XKB_NAME_DETAIL_SYMBOLS).sequence;
+        xcb_flush(m_conn);
+    }
 
-        if (reply) {
-            // Set locks state
-            d->capslock.enabled = reply->lockedMods & d->capslock.mask;
-            d->numlock.enabled  = reply->lockedMods & d->numlock.mask;
+    bool XcbKeyboardBackend::pollLayouts() {
+        if (m_namesRequest != 0) {
+            void *reply = nullptr;
+            xcb_generic_error_t *error = nullptr;
+
+            if (!xcb_poll_for_reply(m_conn, m_namesRequest, &reply, &error))
+                return false;
+            m_namesRequest = 0;
 
-            // Set current layout
-            d->layout_id = reply->group;
+            if (error || !reply) {
+                qCCritical(lcGreeterModels) << "Can't reload layouts: " << (error ? error->error_code : 0);
+                free(error);
+                free(reply);
+                return true;
+            }
 
-            // Free
+            for (const xcb_get_atom_name_cookie_t &cookie : requestAtomNames(static_cast<xcb_xkb_get_names_reply_t *>(reply)))
+                m_atomRequests << cookie.sequence;
+            m_atomNames.clear();
             free(reply);
-        } else {
-            // Log error and disable extension
-            qCritical() << "Can't load leds state - " << error->error_code;
-            d->enabled = false;
+            xcb_flush(m_conn);
         }
+
+        // Replies come back in order, stop at the first one not there yet
+        while (!m_atomRequests.isEmpty()) {
+            void *reply = nullptr;
+            xcb_generic_error_t *error = nullptr;
+
+            if (!xcb_poll_for_reply(m_conn, m_atomRequests.first(), &reply, &error))
+                return false;
+            m_atomRequests.removeFirst();
+
+            if (reply) {
+                xcb_get_atom_name_reply_t *r = static_cast<xcb_get_atom_name_reply_t *>(reply);
+                m_atomNames << QString::fromLocal8Bit(xcb_get_atom_name_name(r),
+                                                      xcb_get_atom_name_name_length(r));
+                free(reply);
+            } else {
+                qCWarning(lcGreeterModels) << "Failed to get atom name: " << (error ? error->error_code : 0);
+                m_atomNames << QString();
+                free(error);
+            }
+
+            if (m_atomRequests.isEmpty()) {
+                setLayouts(m_atomNames);
+                m_atomNames.clear();
+            }
+        }
+
+        if (m_namesStale) {
+            m_namesStale = false;
+            requestLayouts();
+            return false;
+        }
+        return true;
+    }
+
+    void XcbKeyboardBackend::initState(xcb_xkb_get_state_reply_t *state) {
+        if (!state)
+            return;
+
+        // Set locks state
+        d->capslock.enabled = state->lockedMods & d->capslock.mask;
+        d->numlock.enabled  = state->lockedMods & d->numlock.mask;
+
+        // Set current layout
+        d->layout_id = state->group;
     }
 
     QString XcbKeyboardBackend::atomName(xcb_get_atom_name_cookie_t cookie) const {
@@ -234,38 +382,11 @@ namespace SDDM {
             free(reply);
         } else {
             // Log error
-            qWarning() << "Failed to get atom name: " << error->error_code;
+            qCWarning(lcGreeterModels) << "Failed to get atom name: " << error->error_code;
         }
         return res;
     }
 
-    QString XcbKeyboardBackend::atomName(xcb_atom_t atom) const {
-        return atomName(xcb_get_atom_name(m_conn, atom));
-    }
-
-    uint8_t XcbKeyboardBackend::getIndicatorMask(uint8_t i) const {
-        xcb_xkb_get_indicator_map_cookie_t cookie;
-        xcb_xkb_get_indicator_map_reply_t *reply = nullptr;
-        xcb_generic_error_t *error = nullptr;
-        uint8_t mask = 0;
-
-        cookie = xcb_xkb_get_indicator_map(m_conn, XCB_XKB_ID_USE_CORE_KBD, 1 << i);
-        reply = xcb_xkb_get_indicator_map_reply(m_conn, cookie, &error);
-
-
-        if (reply) {
-            xcb_xkb_indicator_map_t *map = xcb_xkb_get_indicator_map_maps(reply);
-
-            mask = map->mods;
-
-            free(reply);
-        } else {
-            // Log error
-            qWarning() << "Can't get indicator mask " << error->error_code;
-        }
-        return mask;
-    }
-
     QList<QString> XcbKeyboardBackend::parseShortNames(QString text) {
         QRegExp re(QStringLiteral(R"(\+([a-z]+))"));
         re.setCaseSensitivity(Qt::CaseInsensitive);
@@ -285,38 +406,101 @@ namespace SDDM {
     }
 
     void XcbKeyboardBackend::dispatchEvents() {
-        // Pool events
-        while (xcb_generic_event_t *event = xcb_poll_for_event(m_conn)) {
-            // Check event types
-            if (event->response_type != 0 && event->pad0 == XCB_XKB_STATE_NOTIFY) {
-                xcb_xkb_state_notify_event_t *e = (xcb_xkb_state_notify_event_t *)event;
+        if (!m_ownsConnection) {
+            // Events were picked up from Qt's queue by nativeEventFilter()
+            const QList<QByteArray> events = m_pendingEvents;
+            m_pendingEvents.clear();
+            for (const QByteArray &event : events)
+                handleEvent(reinterpret_cast<const xcb_generic_event_t *>(event.constData()));
+        } else {
+            // Pool events
+            while (xcb_generic_event_t *event = xcb_poll_for_event(m_conn)) {
+                handleEvent(event);
+                free(event);
+            }
+        }
+
+        // Layout names can't be carried by events, keep checking for the
+        // replies without blocking until they are all in
+        if (!pollLayouts() && m_model)
+            QTimer::singleShot(LayoutsPollInterval, m_model, SLOT(dispatchEvents()));
+    }
+
+    bool XcbKeyboardBackend::nativeEventFilter(const QByteArray &eventType, void *message, long *result) {
+        Q_UNUSED(result);
 
-                // Update state
+        if (eventType != "xcb_generic_event_t")
+            return false;
+
+        xcb_generic_event_t *event = static_cast<xcb_generic_event_t *>(message);
+        if (m_firstEvent == 0 || (event->response_type & ~0x80) != m_firstEvent)
+            return false;
+
+        // Queue a copy and let the model pick it up, Qt still gets to see it
+        bool schedule = m_pendingEvents.isEmpty();
+        m_pendingEvents << QByteArray(reinterpret_cast<const char *>(event), sizeof(xcb_generic_event_t));
+        if (schedule && m_model)
+            QMetaObject::invokeMethod(m_model, "dispatchEvents", Qt::QueuedConnection);
+
+        return false;
+    }
+
+    void XcbKeyboardBackend::handleEvent(const xcb_generic_event_t *event) {
+        // Check event types
+        if ((event->response_type & ~0x80) != m_firstEvent)
+            return;
+
+        if (event->pad0 == XCB_XKB_STATE_NOTIFY) {
+            const xcb_xkb_state_notify_event_t *e = reinterpret_cast<const xcb_xkb_state_notify_event_t *>(event);
+
+            // Update state straight from the payload
+            if (e->changed & XCB_XKB_STATE_PART_MODIFIER_LOCK) {
                 d->capslock.enabled = e->lockedMods & d->capslock.mask;
                 d->numlock.enabled  = e->lockedMods & d->numlock.mask;
+            }
 
+            if (e->changed & XCB_XKB_STATE_PART_GROUP_STATE)
                 d->layout_id = e->group;
-            } else if (event->response_type != 0 && event->pad0 == XCB_XKB_NEW_KEYBOARD_NOTIFY) {
-                // Keyboards changed, reinit layouts
-                initLayouts();
-            }
-            free(event);
+        } else if (event->pad0 == XCB_XKB_NAMES_NOTIFY) {
+            const xcb_xkb_names_notify_event_t *e = reinterpret_cast<const xcb_xkb_names_notify_event_t *>(event);
+
+            // Layouts were renamed or replaced
+            if (e->changed & (XCB_XKB_NAME_DETAIL_GROUP_NAMES | XCB_XKB_NAME_DETAIL_SYMBOLS))
+                requestLayouts();
+        } else if (event->pad0 == XCB_XKB_NEW_KEYBOARD_NOTIFY) {
+            // Keyboards changed, reinit layouts
+            requestLayouts();
         }
     }
 
     void XcbKeyboardBackend::connectEventsDispatcher(KeyboardModel *model) {
-        // Setup events filter
+        if (!d->enabled)
+            return;
+
+        // Setup events filter, only for the parts we display: lock
+        // modifiers, the current group and the layout names. Only the
+        // selected detail bits are touched, so a selection Qt made on a
+        // shared connection stays intact.
         xcb_void_cookie_t cookie;
-        xcb_xkb_select_events_details_t foo;
+        xcb_xkb_select_events_details_t details;
         xcb_generic_error_t *error = nullptr;
 
-        cookie = xcb_xkb_select_events(m_conn, XCB_XKB_ID_USE_CORE_KBD,
-                XCB_XKB_EVENT_TYPE_STATE_NOTIFY | XCB_XKB_EVENT_TYPE_NEW_KEYBOARD_NOTIFY, 0,
-                XCB_XKB_EVENT_TYPE_STATE_NOTIFY | XCB_XKB_EVENT_TYPE_NEW_KEYBOARD_NOTIFY, 0, 0, &foo);
+        memset(&details, 0, sizeof(details));
+        details.affectState = XCB_XKB_STATE_PART_MODIFIER_LOCK | XCB_XKB_STATE_PART_GROUP_STATE;
+        details.stateDetails = details.affectState;
+        details.affectNames = XCB_XKB_NAME_DETAIL_GROUP_NAMES | XCB_XKB_NAME_DETAIL_SYMBOLS;
+        details.namesDetails = details.affectNames;
+        details.affectNewKeyboard = XCB_XKB_NKN_DETAIL_KEYCODES;
+        details.newKeyboardDetails = details.affectNewKeyboard;
+
+        cookie = xcb_xkb_select_events_aux_checked(m_conn, XCB_XKB_ID_USE_CORE_KBD,
+                XCB_XKB_EVENT_TYPE_STATE_NOTIFY | XCB_XKB_EVENT_TYPE_NAMES_NOTIFY |
+                XCB_XKB_EVENT_TYPE_NEW_KEYBOARD_NOTIFY,
+                0, 0, 0, 0, &details);
         // Check errors
         error = xcb_request_check(m_conn, cookie);
         if (error) {
-            qCritical() << "Can't select xck-xkb events: " << error->error_code;
+            qCCritical(lcGreeterModels) << "Can't select xck-xkb events: " << error->error_code;
             d->enabled = false;
             return;
         }
@@ -324,6 +508,14 @@ namespace SDDM {
         // Flush connection
         xcb_flush(m_conn);
 
+        m_model = model;
+
+        // Qt reads its own connection, listen to what it dispatches
+        if (!m_ownsConnection) {
+            qApp->installNativeEventFilter(this);
+            return;
+        }
+
         // Get file descripor and init socket listener
         int fd = xcb_get_file_descriptor(m_conn);
         m_socket = new QSocketNotifier(fd, QSocketNotifier::Read);
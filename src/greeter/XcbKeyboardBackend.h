@@ -20,7 +20,10 @@
 #ifndef XCBKEYBOARDBACKEND_H
 #define XCBKEYBOARDBACKEND_H
 
+#include <QtCore/QAbstractNativeEventFilter>
+#include <QtCore/QList>
 #include <QtCore/QString>
+#include <QtCore/QStringList>
 
 #include "KeyboardBackend.h"
 
@@ -31,7 +34,7 @@
 class QSocketNotifier;
 
 namespace SDDM {
-    class XcbKeyboardBackend : public KeyboardBackend {
+    class XcbKeyboardBackend : public KeyboardBackend, public QAbstractNativeEventFilter {
     public:
         XcbKeyboardBackend(KeyboardModelPrivate *kmp);
         virtual ~XcbKeyboardBackend();
@@ -43,23 +46,41 @@ namespace SDDM {
 
         void connectEventsDispatcher(KeyboardModel *model) override;
 
+        bool nativeEventFilter(const QByteArray &eventType, void *message, long *result) override;
+
         static QList<QString> parseShortNames(QString text);
 
     private:
         // Initializers
         void connectToDisplay();
-        void initLedMap();
-        void initLayouts();
-        void initState();
+        void initLedMap(xcb_xkb_get_names_reply_t *names, xcb_xkb_get_indicator_map_reply_t *maps,
+                        xcb_atom_t numLock, xcb_atom_t capsLock);
+        void initState(xcb_xkb_get_state_reply_t *state);
+
+        // Layouts
+        QList<xcb_get_atom_name_cookie_t> requestAtomNames(xcb_xkb_get_names_reply_t *names);
+        void setLayouts(const QStringList &names);
+        void requestLayouts();
+        bool pollLayouts();
 
         // Helpers
-        QString atomName(xcb_atom_t atom) const;
         QString atomName(xcb_get_atom_name_cookie_t cookie) const;
+        void handleEvent(const xcb_generic_event_t *event);
 
-        uint8_t getIndicatorMask(uint8_t id) const;
-
-        // Connection
+        // Connection, shared with Qt unless we had to open our own
         xcb_connection_t *m_conn { nullptr };
+        bool m_ownsConnection { false };
+        uint8_t m_firstEvent { 0 };
+
+        // Events seen by nativeEventFilter(), waiting for dispatchEvents()
+        KeyboardModel *m_model { nullptr };
+        QList<QByteArray> m_pendingEvents;
+
+        // Layout names requested after a change, collected by pollLayouts()
+        unsigned int m_namesRequest { 0 };
+        QList<unsigned int> m_atomRequests;
+        QStringList m_atomNames;
+        bool m_namesStale { false };
 
         // Socket listener
         QSocketNotifier *m_socket { nullptr };
@@ -85,6 +85,7 @@ Rectangle {
                 state: (listView.currentIndex === index) ? "active" : ""
 
                 onLogin: sddm.login(model.name, password, sessionIndex);
+                onStateChanged: if (state === "active") sddm.prepareLogin(model.name, sessionIndex);
 
                 MouseArea {
                     anchors.fill: parent
@@ -20,6 +20,8 @@
 
 #include "HelperApp.h"
 #include "Backend.h"
+#include "Configuration.h"
+#include "LogCategories.h"
 #include "UserSession.h"
 #include "SafeDataStream.h"
 
@@ -49,6 +51,7 @@ namespace SDDM {
             , m_session(new UserSession(this))
             , m_socket(new QLocalSocket(this)) {
         qInstallMessageHandler(HelperMessageHandler);
+        setLogRules(mainConfig.LogRules.get());
 
         QTimer::singleShot(0, this, SLOT(setUp()));
     }
@@ -102,6 +105,10 @@ namespace SDDM {
             m_backend->setGreeter(true);
         }
 
+        if ((pos = args.indexOf(QStringLiteral("--spare"))) >= 0) {
+            m_spare = true;
+        }
+
         if (server.isEmpty() || m_id <= 0) {
             qCritical() << "This application is not supposed to be executed manually";
             exit(Auth::HELPER_OTHER_ERROR);
@@ -120,14 +127,17 @@ namespace SDDM {
         if (str.status() != QDataStream::Ok)
             qCritical() << "Couldn't write initial message:" << str.status();
 
+        // spawned ahead of time, wait for the login to be handed over
+        if (m_spare && !waitForStart()) {
+            exit(Auth::HELPER_OTHER_ERROR);
+            return;
+        }
+
         if (!m_backend->start(m_user)) {
             authenticated(QString());
 
-            // write failed login to btmp
-            QProcessEnvironment env = m_session->processEnvironment();
-            QString displayId = env.value(QStringLiteral("DISPLAY"));
-            QString vt = env.value(QStringLiteral("XDG_VTNR"));
-            utmpLogin(vt, displayId, m_user, 0, false);
+            // failed login goes to btmp, written by the daemon
+            account(UtmpRecord::FailedLogin, 0);
 
             exit(Auth::HELPER_AUTH_ERROR);
             return;
@@ -136,11 +146,8 @@ namespace SDDM {
         if (!m_backend->authenticate()) {
             authenticated(QString());
 
-            // write failed login to btmp
-            QProcessEnvironment env = m_session->processEnvironment();
-            QString displayId = env.value(QStringLiteral("DISPLAY"));
-            QString vt = env.value(QStringLiteral("XDG_VTNR"));
-            utmpLogin(vt, displayId, m_user, 0, false);
+            // failed login goes to btmp, written by the daemon
+            account(UtmpRecord::FailedLogin, 0);
 
             exit(Auth::HELPER_AUTH_ERROR);
             return;
@@ -154,7 +161,13 @@ namespace SDDM {
             // Allocate a new VT for the wayland session
             if(env.value(QStringLiteral("XDG_SESSION_TYPE")) == QLatin1String("wayland")) {
                 int vtNumber = VirtualTerminal::setUpNewVt();
-                env.insert(QStringLiteral("XDG_VTNR"), QString::number(vtNumber));
+                if (vtNumber > 0) {
+                    // held until the session ends so the daemon won't put an X server on it
+                    m_reservedVt = vtNumber;
+                    env.insert(QStringLiteral("XDG_VTNR"), QString::number(vtNumber));
+                } else {
+                    qWarning() << "No free VT for the wayland session";
+                }
             }
             m_session->setProcessEnvironment(env);
 
@@ -167,13 +180,10 @@ namespace SDDM {
             sessionOpened(true);
 
             // write successful login to utmp/wtmp
-            QProcessEnvironment env = m_session->processEnvironment();
-            QString displayId = env.value(QStringLiteral("DISPLAY"));
-            QString vt = env.value(QStringLiteral("XDG_VTNR"));
-            if (env.value(QStringLiteral("XDG_SESSION_CLASS")) != QLatin1String("greeter")) {
+            if (m_session->processEnvironment().value(QStringLiteral("XDG_SESSION_CLASS")) != QLatin1String("greeter")) {
                 // cache pid for session end
                 m_session->setCachedProcessId(m_session->processId());
-                utmpLogin(vt, displayId, m_user, m_session->processId(), true);
+                account(UtmpRecord::Login, m_session->processId());
             }
         }
         else
@@ -181,19 +191,71 @@ namespace SDDM {
         return;
     }
 
+    bool HelperApp::waitForStart() {
+        Msg m = Msg::MSG_UNKNOWN;
+        QString path;
+        bool autologin = false, greeter = false;
+        SafeDataStream str(m_socket);
+        str.receive();
+        str >> m >> m_user >> path >> autologin >> greeter;
+        if (m != START) {
+            qCritical() << "Received a wrong opcode instead of START:" << m;
+            return false;
+        }
+
+        if (!path.isEmpty())
+            m_session->setPath(path);
+        m_backend->setAutologin(autologin);
+        m_backend->setGreeter(greeter);
+        return true;
+    }
+
     void HelperApp::sessionFinished(int status) {
         m_backend->closeSession();
 
+        if (m_reservedVt > 0)
+            VirtualTerminal::releaseVt(m_reservedVt);
+
         // write logout to utmp/wtmp
-        qint64 pid = m_session->cachedProcessId();
+        if (m_session->processEnvironment().value(QStringLiteral("XDG_SESSION_CLASS")) != QLatin1String("greeter"))
+            account(UtmpRecord::Logout, m_session->cachedProcessId());
+
+        exit(status);
+    }
+
+    void HelperApp::account(UtmpRecord::Type type, qint64 pid) {
         QProcessEnvironment env = m_session->processEnvironment();
-        if (env.value(QStringLiteral("XDG_SESSION_CLASS")) != QLatin1String("greeter")) {
-            QString vt = env.value(QStringLiteral("XDG_VTNR"));
-            QString displayId = env.value(QStringLiteral("DISPLAY"));
-            utmpLogout(vt, displayId, pid);
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+
+        UtmpRecord record;
+        record.type = type;
+        record.vt = env.value(QStringLiteral("XDG_VTNR"));
+        record.displayName = env.value(QStringLiteral("DISPLAY"));
+        if (type != UtmpRecord::Logout)
+            record.user = m_user;
+        record.pid = pid;
+        record.seconds = tv.tv_sec;
+        record.microseconds = tv.tv_usec;
+
+        // hand the record over to the daemon, it spools it right away and
+        // writes the databases in batches
+        if (m_socket->state() == QLocalSocket::ConnectedState) {
+            SafeDataStream str(m_socket);
+            str << Msg::ACCOUNTING << record;
+            str.send();
+            // once the kernel has it the daemon reads it, even after we
+            // exited, before it considers the helper finished
+            if (m_socket->state() == QLocalSocket::ConnectedState && m_socket->bytesToWrite() == 0)
+                return;
         }
 
-        exit(status);
+        // the daemon is gone, don't lose the record
+        qWarning() << "Failed to hand over accounting record, writing it directly";
+        if (type == UtmpRecord::Logout)
+            utmpLogout(record.vt, record.displayName, pid);
+        else
+            utmpLogin(record.vt, record.displayName, record.user, pid, type == UtmpRecord::Login);
     }
 
     void HelperApp::info(const QString& message, Auth::Info type) {
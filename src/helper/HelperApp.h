@@ -25,6 +25,7 @@
 #include <QtCore/QProcessEnvironment>
 
 #include "AuthMessages.h"
+#include "UtmpRecord.h"
 
 class QLocalSocket;
 
@@ -56,10 +57,24 @@ namespace SDDM {
         void sessionFinished(int status);
 
     private:
+        bool waitForStart();
+
+        /*!
+         \brief Send a utmp/wtmp/btmp record to the daemon
+         \param type  Login, logout or failed login
+         \param pid  User process ID (e.g. PID of startkde)
+
+         Falls back to \ref utmpLogin and \ref utmpLogout when the daemon
+         can't be reached.
+        */
+        void account(UtmpRecord::Type type, qint64 pid);
+
         qint64 m_id { -1 };
+        bool m_spare { false };
         Backend *m_backend { nullptr };
         UserSession *m_session { nullptr };
         QLocalSocket *m_socket { nullptr };
+        int m_reservedVt { -1 };
         QString m_user { };
         // TODO: get rid of this in a nice clean way along the way with moving to user session X server
         QString m_cookie { };
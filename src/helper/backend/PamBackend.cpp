@@ -19,10 +19,12 @@
  */
 
 #include "PamBackend.h"
+
 #include "PamHandle.h"
 #include "HelperApp.h"
 #include "UserSession.h"
 #include "Auth.h"
+#include "LogCategories.h"
 
 #include <QtCore/QString>
 #include <QtCore/QDebug>
@@ -181,7 +183,7 @@ namespace SDDM {
 
     void PamData::completeRequest(const Request& request) {
         if (request.prompts.length() != m_currentRequest.prompts.length()) {
-            qWarning() << "[PAM] Different request/response list length, ignoring";
+            qCWarning(lcAuth) << "[PAM] Different request/response list length, ignoring";
             return;
         }
 
@@ -189,7 +191,7 @@ namespace SDDM {
             if (request.prompts[i].type != m_currentRequest.prompts[i].type
                 || request.prompts[i].message != m_currentRequest.prompts[i].message
                 || request.prompts[i].hidden != m_currentRequest.prompts[i].hidden) {
-                qWarning() << "[PAM] Order or type of the messages doesn't match, ignoring";
+                qCWarning(lcAuth) << "[PAM] Order or type of the messages doesn't match, ignoring";
                 return;
             }
         }
@@ -276,12 +278,12 @@ namespace SDDM {
 
     bool PamBackend::closeSession() {
         if (m_pam->isOpen()) {
-            qDebug() << "[PAM] Closing session";
+            qCDebug(lcAuth) << "[PAM] Closing session";
             m_pam->closeSession();
             m_pam->setCred(PAM_DELETE_CRED);
             return true;
         }
-        qWarning() << "[PAM] Asked to close the session but it wasn't previously open";
+        qCWarning(lcAuth) << "[PAM] Asked to close the session but it wasn't previously open";
         return Backend::closeSession();
     }
 
@@ -290,7 +292,7 @@ namespace SDDM {
     }
 
     int PamBackend::converse(int n, const struct pam_message **msg, struct pam_response **resp) {
-        qDebug() << "[PAM] Conversation with" << n << "messages";
+        qCDebug(lcAuth) << "[PAM] Conversation with" << n << "messages";
 
         bool newRequest = false;
 
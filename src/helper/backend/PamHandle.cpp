@@ -18,7 +18,9 @@
  *
  */
 #include "PamHandle.h"
+
 #include "PamBackend.h"
+#include "LogCategories.h"
 
 #include <QtCore/QDebug>
 
@@ -28,7 +30,7 @@ namespace SDDM {
         for (const QString& s : envs) {
             m_result = pam_putenv(m_handle, qPrintable(s));
             if (m_result != PAM_SUCCESS) {
-                qWarning() << "[PAM] putEnv:" << pam_strerror(m_handle, m_result);
+                qCWarning(lcAuth) << "[PAM] putEnv:" << pam_strerror(m_handle, m_result);
                 return false;
             }
         }
@@ -40,7 +42,7 @@ namespace SDDM {
         // get pam environment
         char **envlist = pam_getenvlist(m_handle);
         if (envlist == NULL) {
-            qWarning() << "[PAM] getEnv: Returned NULL";
+            qCWarning(lcAuth) << "[PAM] getEnv: Returned NULL";
             return env;
         }
 
@@ -64,7 +66,7 @@ namespace SDDM {
     bool PamHandle::chAuthTok(int flags) {
         m_result = pam_chauthtok(m_handle, flags | m_silent);
         if (m_result != PAM_SUCCESS) {
-            qWarning() << "[PAM] chAuthTok:" << pam_strerror(m_handle, m_result);
+            qCWarning(lcAuth) << "[PAM] chAuthTok:" << pam_strerror(m_handle, m_result);
         }
         return m_result == PAM_SUCCESS;
     }
@@ -76,26 +78,26 @@ namespace SDDM {
             return chAuthTok(PAM_CHANGE_EXPIRED_AUTHTOK);
         }
         else if (m_result != PAM_SUCCESS) {
-            qWarning() << "[PAM] acctMgmt:" << pam_strerror(m_handle, m_result);
+            qCWarning(lcAuth) << "[PAM] acctMgmt:" << pam_strerror(m_handle, m_result);
             return false;
         }
         return true;
     }
 
     bool PamHandle::authenticate(int flags) {
-        qDebug() << "[PAM] Authenticating...";
+        qCDebug(lcAuth) << "[PAM] Authenticating...";
         m_result = pam_authenticate(m_handle, flags | m_silent);
         if (m_result != PAM_SUCCESS) {
-            qWarning() << "[PAM] authenticate:" << pam_strerror(m_handle, m_result);
+            qCWarning(lcAuth) << "[PAM] authenticate:" << pam_strerror(m_handle, m_result);
         }
-        qDebug() << "[PAM] returning.";
+        qCDebug(lcAuth) << "[PAM] returning.";
         return m_result == PAM_SUCCESS;
     }
 
     bool PamHandle::setCred(int flags) {
         m_result = pam_setcred(m_handle, flags | m_silent);
         if (m_result != PAM_SUCCESS) {
-            qWarning() << "[PAM] setCred:" << pam_strerror(m_handle, m_result);
+            qCWarning(lcAuth) << "[PAM] setCred:" << pam_strerror(m_handle, m_result);
         }
         return m_result == PAM_SUCCESS;
     }
@@ -103,7 +105,7 @@ namespace SDDM {
     bool PamHandle::openSession() {
         m_result = pam_open_session(m_handle, m_silent);
         if (m_result != PAM_SUCCESS) {
-            qWarning() << "[PAM] openSession:" << pam_strerror(m_handle, m_result);
+            qCWarning(lcAuth) << "[PAM] openSession:" << pam_strerror(m_handle, m_result);
         }
         m_open = m_result == PAM_SUCCESS;
         return m_open;
@@ -112,7 +114,7 @@ namespace SDDM {
     bool PamHandle::closeSession() {
         m_result = pam_close_session(m_handle, m_silent);
         if (m_result != PAM_SUCCESS) {
-            qWarning() << "[PAM] closeSession:" << pam_strerror(m_handle, m_result);
+            qCWarning(lcAuth) << "[PAM] closeSession:" << pam_strerror(m_handle, m_result);
         }
         return m_result == PAM_SUCCESS;
     }
@@ -124,7 +126,7 @@ namespace SDDM {
     bool PamHandle::setItem(int item_type, const void* item) {
         m_result = pam_set_item(m_handle, item_type, item);
         if (m_result != PAM_SUCCESS) {
-            qWarning() << "[PAM] setItem:" << pam_strerror(m_handle, m_result);
+            qCWarning(lcAuth) << "[PAM] setItem:" << pam_strerror(m_handle, m_result);
         }
         return m_result == PAM_SUCCESS;
     }
@@ -133,13 +135,13 @@ namespace SDDM {
         const void *item;
         m_result = pam_get_item(m_handle, item_type, &item);
         if (m_result != PAM_SUCCESS) {
-            qWarning() << "[PAM] getItem:" << pam_strerror(m_handle, m_result);
+            qCWarning(lcAuth) << "[PAM] getItem:" << pam_strerror(m_handle, m_result);
         }
         return item;
     }
 
     int PamHandle::converse(int n, const struct pam_message **msg, struct pam_response **resp, void *data) {
-        qDebug() << "[PAM] Preparing to converse...";
+        qCDebug(lcAuth) << "[PAM] Preparing to converse...";
         PamBackend *c = static_cast<PamBackend *>(data);
         return c->converse(n, msg, resp);
     }
@@ -150,11 +152,11 @@ namespace SDDM {
         else
             m_result = pam_start(qPrintable(service), qPrintable(user), &m_conv, &m_handle);
         if (m_result != PAM_SUCCESS) {
-            qWarning() << "[PAM] start" << pam_strerror(m_handle, m_result);
+            qCWarning(lcAuth) << "[PAM] start" << pam_strerror(m_handle, m_result);
             return false;
         }
         else {
-            qDebug() << "[PAM] Starting...";
+            qCDebug(lcAuth) << "[PAM] Starting...";
         }
         return true;
     }
@@ -164,11 +166,11 @@ namespace SDDM {
             return false;
         m_result = pam_end(m_handle, m_result | flags);
         if (m_result != PAM_SUCCESS) {
-            qWarning() << "[PAM] end:" << pam_strerror(m_handle, m_result);
+            qCWarning(lcAuth) << "[PAM] end:" << pam_strerror(m_handle, m_result);
             return false;
         }
         else {
-            qDebug() << "[PAM] Ended.";
+            qCDebug(lcAuth) << "[PAM] Ended.";
         }
         m_handle = NULL;
         return true;
@@ -22,6 +22,7 @@
 
 #include "AuthMessages.h"
 #include "HelperApp.h"
+#include "LogCategories.h"
 
 #include <QtCore/QDebug>
 
@@ -79,7 +80,7 @@ namespace SDDM {
 #ifdef HAVE_GETSPNAM
         struct spwd *spw = getspnam(pw->pw_name);
         if (!spw) {
-            qWarning() << "[Passwd] Could get passwd but not shadow";
+            qCWarning(lcAuth) << "[Passwd] Could get passwd but not shadow";
             return false;
         }
 
@@ -244,4 +244,12 @@ void ConfigurationTest::FileChanged()
     QVERIFY(config->Int.get() == 222222);
 }
 
+void ConfigurationTest::IniValues() {
+    QCOMPARE(SDDM::parseIniValue(QStringLiteral("background.jpg")), QVariant(QStringLiteral("background.jpg")));
+    QCOMPARE(SDDM::parseIniValue(QStringLiteral("#1e90ff ; comment")), QVariant(QStringLiteral("#1e90ff")));
+    QCOMPARE(SDDM::parseIniValue(QStringLiteral("\" a; b \"")), QVariant(QStringLiteral(" a; b ")));
+    QCOMPARE(SDDM::parseIniValue(QStringLiteral("first line\\nsecond line")), QVariant(QStringLiteral("first line\nsecond line")));
+    QCOMPARE(SDDM::parseIniValue(QStringLiteral("Noto Sans, 10")), QVariant(QStringList({QStringLiteral("Noto Sans"), QStringLiteral("10")})));
+}
+
 #include "moc_ConfigurationTest.cpp"
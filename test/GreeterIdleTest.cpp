@@ -0,0 +1,90 @@
+/*
+ * Greeter idle CPU usage test
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "GreeterIdleTest.h"
+
+#include <QtTest/QtTest>
+#include <QtCore/QFile>
+#include <QtCore/QProcess>
+
+#include <unistd.h>
+
+QTEST_MAIN(GreeterIdleTest);
+
+// user and system CPU time of a process, in seconds
+static double cpuTime(qint64 pid) {
+    QFile file(QStringLiteral("/proc/%1/stat").arg(pid));
+    if (!file.open(QIODevice::ReadOnly))
+        return -1;
+
+    // utime and stime are fields 14 and 15, skip past the command name
+    const QByteArray stat = file.readAll();
+    const QList<QByteArray> fields = stat.mid(stat.lastIndexOf(')') + 2).split(' ');
+    if (fields.size() < 13)
+        return -1;
+
+    return double(fields.at(11).toLongLong() + fields.at(12).toLongLong()) / sysconf(_SC_CLK_TCK);
+}
+
+// a duration in seconds from the environment, or the default
+static int seconds(const char *name, int fallback) {
+    bool ok = false;
+    const int value = qEnvironmentVariableIntValue(name, &ok);
+    return ok && value > 0 ? value : fallback;
+}
+
+void GreeterIdleTest::init() {
+    greeter = new QProcess;
+    greeter->setProcessChannelMode(QProcess::ForwardedChannels);
+}
+
+void GreeterIdleTest::cleanup() {
+    greeter->terminate();
+    if (!greeter->waitForFinished(5000))
+        greeter->kill();
+    delete greeter;
+    greeter = nullptr;
+}
+
+void GreeterIdleTest::IdleCpuTime() {
+    if (qEnvironmentVariableIsEmpty("DISPLAY"))
+        QSKIP("No X display to run the greeter on");
+
+    greeter->start(QStringLiteral(GREETER_PATH), { QStringLiteral("--test-mode") });
+    QVERIFY(greeter->waitForStarted());
+
+    const int warmup = seconds("SDDM_TEST_WARMUP_SECONDS", WARMUP_SECONDS);
+    const int idle = seconds("SDDM_TEST_IDLE_SECONDS", IDLE_SECONDS);
+
+    QTest::qWait(warmup * 1000);
+    QCOMPARE(greeter->state(), QProcess::Running);
+    const double before = cpuTime(greeter->processId());
+    QVERIFY(before >= 0);
+
+    QTest::qWait(idle * 1000);
+    QCOMPARE(greeter->state(), QProcess::Running);
+    const double after = cpuTime(greeter->processId());
+    QVERIFY(after >= 0);
+
+    const double usage = (after - before) / idle;
+    qDebug() << "Greeter used" << (after - before) << "s of CPU time in" << idle << "idle seconds";
+    QVERIFY2(usage <= MAX_IDLE_CPU, qPrintable(QStringLiteral("idle CPU usage %1 is above %2").arg(usage).arg(MAX_IDLE_CPU)));
+}
+
+#include "moc_GreeterIdleTest.cpp"
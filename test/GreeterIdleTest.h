@@ -0,0 +1,49 @@
+/*
+ * Greeter idle CPU usage test
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef GREETERIDLETEST_H
+#define GREETERIDLETEST_H
+
+#include <QObject>
+
+class QProcess;
+
+// time the greeter gets to start up before measuring,
+// SDDM_TEST_WARMUP_SECONDS overrides it
+#define WARMUP_SECONDS 5
+// idle time over which the CPU usage is measured,
+// SDDM_TEST_IDLE_SECONDS overrides it
+#define IDLE_SECONDS 60
+// the greeter may use at most this share of a CPU while idle
+#define MAX_IDLE_CPU 0.02
+
+class GreeterIdleTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    void init();
+    void cleanup();
+
+    void IdleCpuTime();
+
+private:
+    QProcess *greeter { nullptr };
+};
+
+#endif // GREETERIDLETEST_H
@@ -0,0 +1,117 @@
+/***************************************************************************
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+
+#include "ProtocolBenchmark.h"
+
+#include "Messages.h"
+#include "SocketServer.h"
+#include "SocketWriter.h"
+
+#include <QtTest/QtTest>
+#include <QtCore/QElapsedTimer>
+#include <QtNetwork/QLocalSocket>
+
+QTEST_MAIN(ProtocolBenchmark);
+
+void ProtocolBenchmark::initTestCase() {
+    server = new SDDM::SocketServer;
+    QVERIFY(server->start(QStringLiteral("benchmark")));
+
+    // act as the display, reject every login straight away
+    connect(server, &SDDM::SocketServer::login, this, &ProtocolBenchmark::answerLogin);
+    connect(this, SIGNAL(loginFailed(QLocalSocket*)), server, SLOT(loginFailed(QLocalSocket*)));
+
+    greeter = new QLocalSocket;
+    greeter->connectToServer(server->socketAddress());
+    QVERIFY(greeter->waitForConnected(5000));
+}
+
+void ProtocolBenchmark::cleanupTestCase() {
+    delete greeter;
+    greeter = nullptr;
+
+    server->stop();
+    delete server;
+    server = nullptr;
+}
+
+void ProtocolBenchmark::sendLogins(int count) {
+    // cork everything into a single write
+    SDDM::SocketWriter writer(greeter);
+    for (int i = 0; i < count; ++i) {
+        writer.nextMessage() << quint32(SDDM::GreeterMessages::Login)
+                             << QStringLiteral("user") << QStringLiteral("password")
+                             << quint32(0) << QStringLiteral("benchmark.desktop");
+    }
+}
+
+void ProtocolBenchmark::answerLogin(QLocalSocket *socket) {
+    emit loginFailed(socket);
+}
+
+void ProtocolBenchmark::waitForReplies(int count) {
+    QElapsedTimer timer;
+    timer.start();
+
+    QByteArray message;
+    while (count > 0) {
+        // both ends share the event loop
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents, 100);
+        greeterReader.append(greeter->readAll());
+
+        while (greeterReader.next(message)) {
+            QDataStream input(message);
+            input.setVersion(SDDM::ProtocolStreamVersion);
+
+            quint32 type;
+            input >> type;
+            QCOMPARE(SDDM::DaemonMessages(type), SDDM::DaemonMessages::LoginFailed);
+            --count;
+        }
+
+        QVERIFY(!greeterReader.hasError());
+        QVERIFY2(greeter->state() == QLocalSocket::ConnectedState, "the daemon dropped the connection");
+        QVERIFY2(timer.elapsed() < 10000, "timed out waiting for the daemon");
+    }
+}
+
+void ProtocolBenchmark::LoginRoundTrip() {
+    QBENCHMARK {
+        sendLogins(1);
+        waitForReplies(1);
+    }
+}
+
+void ProtocolBenchmark::LoginThroughput() {
+    QElapsedTimer timer;
+    qint64 elapsed = 0;
+    int rounds = 0;
+
+    QBENCHMARK {
+        timer.start();
+        sendLogins(BATCH_SIZE);
+        waitForReplies(BATCH_SIZE);
+        elapsed += timer.nsecsElapsed();
+        ++rounds;
+    }
+
+    qDebug() << "Throughput:" << qint64(double(BATCH_SIZE) * rounds * 1e9 / elapsed) << "logins/s";
+}
+
+#include "moc_ProtocolBenchmark.cpp"
@@ -0,0 +1,59 @@
+/***************************************************************************
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the
+* Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+***************************************************************************/
+
+
+#ifndef PROTOCOLBENCHMARK_H
+#define PROTOCOLBENCHMARK_H
+
+#include <QObject>
+
+#include "SocketReader.h"
+
+class QLocalSocket;
+
+namespace SDDM {
+    class SocketServer;
+}
+
+// logins sent back to back by the throughput benchmark
+#define BATCH_SIZE 1000
+
+class ProtocolBenchmark : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void LoginRoundTrip();
+    void LoginThroughput();
+
+signals:
+    void loginFailed(QLocalSocket *socket);
+
+private:
+    void sendLogins(int count);
+    void answerLogin(QLocalSocket *socket);
+    void waitForReplies(int count);
+
+    SDDM::SocketServer *server { nullptr };
+    QLocalSocket *greeter { nullptr };
+    SDDM::SocketReader greeterReader;
+};
+
+#endif // PROTOCOLBENCHMARK_H